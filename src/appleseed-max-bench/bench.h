@@ -0,0 +1,72 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// Standard headers.
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+//
+// Minimal benchmarking utilities. The code exercised by the benchmarks does not depend on
+// the 3ds Max SDK, so this program only links against appleseed.
+//
+
+// Run `function` a number of times and return the duration of the fastest run in milliseconds.
+template <typename Function>
+double measure_ms(Function function, const size_t run_count = 5)
+{
+    double best_ms = 0.0;
+
+    for (size_t i = 0; i < run_count; ++i)
+    {
+        const auto begin = std::chrono::high_resolution_clock::now();
+        function();
+        const auto end = std::chrono::high_resolution_clock::now();
+
+        const double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+        if (i == 0 || ms < best_ms)
+            best_ms = ms;
+    }
+
+    return best_ms;
+}
+
+// Print the duration of a benchmark and the throughput it corresponds to.
+void report(const char* name, const double ms, const size_t item_count);
+
+// Print `message` and return false if `condition` does not hold, return true otherwise.
+bool check(const bool condition, const char* message);
+
+// Benchmarks. Each one prints its timings and returns false if one of its checks failed.
+bool run_transform_benchmarks();
+bool run_material_slot_map_benchmarks();
+bool run_unique_name_benchmarks();
+bool run_expr_formatter_benchmarks();
+bool run_mesh_conversion_benchmarks();
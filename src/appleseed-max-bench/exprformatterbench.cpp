@@ -0,0 +1,195 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed-max headers.
+#include "bench.h"
+#include "exprformatter.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/color.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/string.h"
+
+// Standard headers.
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace asf = foundation;
+
+//
+// Compare ExprFormatter with formatting OSL expressions through foundation::format() as
+// fmt_osl_expr() used to do, and check that numbers are written without loss.
+//
+
+namespace
+{
+    const size_t ExpressionCount = 1024 * 1024;
+    const size_t RoundTripCount = 2 * 1000 * 1000;
+
+    // Values as typed in the user interface, with a few decimals, or with full precision.
+    std::vector<float> make_test_values(const size_t count, const bool full_precision)
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> dist(0.0f, 10.0f);
+
+        std::vector<float> values(count);
+        for (auto& value : values)
+        {
+            value = dist(rng);
+            if (!full_precision)
+                value = std::floor(value * 1000.0f) / 1000.0f;
+        }
+
+        return values;
+    }
+
+    void run_float_benchmark(const char* label, const std::vector<float>& values, size_t& length)
+    {
+        const double format_ms =
+            measure_ms([&]()
+            {
+                for (size_t i = 0; i < ExpressionCount; ++i)
+                    length += asf::format("float {0}", values[i]).size();
+            }, 3);
+        report((std::string(label) + ", foundation::format()").c_str(), format_ms, ExpressionCount);
+
+        const double formatter_ms =
+            measure_ms([&]()
+            {
+                ExprFormatter formatter;
+                for (size_t i = 0; i < ExpressionCount; ++i)
+                    length += std::strlen(formatter.osl(values[i]));
+            }, 3);
+        report((std::string(label) + ", ExprFormatter").c_str(), formatter_ms, ExpressionCount);
+    }
+
+    // Format random finite floats of all magnitudes and check that they read back exactly.
+    bool check_float_round_trip()
+    {
+        std::mt19937 rng(42);
+        char buffer[NumberStringCapacity];
+        size_t failure_count = 0;
+
+        for (size_t i = 0; i < RoundTripCount; )
+        {
+            const asf::uint32 bits = rng();
+
+            float value;
+            std::memcpy(&value, &bits, sizeof(float));
+            if (value != value || std::abs(value) > std::numeric_limits<float>::max())
+                continue;
+
+            format_float(buffer, value);
+
+            const float parsed = static_cast<float>(std::strtod(buffer, nullptr));
+            asf::uint32 parsed_bits;
+            std::memcpy(&parsed_bits, &parsed, sizeof(float));
+            if (parsed_bits != bits)
+                ++failure_count;
+
+            ++i;
+        }
+
+        return check(failure_count == 0, "format_float() wrote floats that do not read back exactly");
+    }
+
+    bool check_int_formatting()
+    {
+        std::vector<int> values;
+        values.push_back(0);
+        values.push_back(1);
+        values.push_back(-1);
+        values.push_back(std::numeric_limits<int>::max());
+        values.push_back(std::numeric_limits<int>::min());
+
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> dist(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+        for (size_t i = 0; i < 1000 * 1000; ++i)
+            values.push_back(dist(rng));
+
+        char buffer[NumberStringCapacity];
+        size_t failure_count = 0;
+
+        for (const auto value : values)
+        {
+            format_int(buffer, value);
+            if (std::to_string(static_cast<long long>(value)) != buffer)
+                ++failure_count;
+        }
+
+        return check(failure_count == 0, "format_int() wrote wrong digits");
+    }
+}
+
+bool run_expr_formatter_benchmarks()
+{
+    const std::vector<float> short_values = make_test_values(ExpressionCount + 2, false);
+    const std::vector<float> full_values = make_test_values(ExpressionCount, true);
+
+    // Accumulate the lengths of the expressions so that formatting can't be optimized away.
+    size_t length = 0;
+
+    // Values with more than 6 significant digits take several attempts to find the shortest
+    // representation that reads back exactly, whereas foundation::format() rounds them. The
+    // attempts are rounded from a single conversion to 9 digits and rarely need parsing.
+    run_float_benchmark("floats with 3 decimals", short_values, length);
+    run_float_benchmark("floats with full precision", full_values, length);
+
+    const double format_color_ms =
+        measure_ms([&]()
+        {
+            for (size_t i = 0; i < ExpressionCount; ++i)
+                length += asf::format("color {0} {1} {2}", short_values[i], short_values[i + 1], short_values[i + 2]).size();
+        }, 3);
+    report("colors with 3 decimals, foundation::format()", format_color_ms, ExpressionCount);
+
+    const double formatter_color_ms =
+        measure_ms([&]()
+        {
+            ExprFormatter formatter;
+            for (size_t i = 0; i < ExpressionCount; ++i)
+                length += std::strlen(formatter.osl(asf::Color3f(short_values[i], short_values[i + 1], short_values[i + 2])));
+        }, 3);
+    report("colors with 3 decimals, ExprFormatter", formatter_color_ms, ExpressionCount);
+
+    bool success = length > 0;
+
+    if (!check_float_round_trip())
+        success = false;
+
+    if (!check_int_formatting())
+        success = false;
+
+    return success;
+}
@@ -0,0 +1,112 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed-max headers.
+#include "bench.h"
+
+// Standard headers.
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+//
+// Run the benchmarks whose names are given on the command line, or all of them. The exit
+// code is non-zero if a benchmark failed one of its checks, so this program doubles as a
+// regression test.
+//
+
+namespace
+{
+    struct Benchmark
+    {
+        const char*     m_name;
+        bool            (*m_run)();
+    };
+
+    const Benchmark Benchmarks[] =
+    {
+        { "transform", run_transform_benchmarks },
+        { "materialslotmap", run_material_slot_map_benchmarks },
+        { "uniquename", run_unique_name_benchmarks },
+        { "exprformatter", run_expr_formatter_benchmarks },
+        { "meshconversion", run_mesh_conversion_benchmarks }
+    };
+
+    const size_t BenchmarkCount = sizeof(Benchmarks) / sizeof(Benchmarks[0]);
+
+    bool is_selected(const char* name, const int argc, char* argv[])
+    {
+        if (argc < 2)
+            return true;
+
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], name) == 0)
+                return true;
+        }
+
+        return false;
+    }
+}
+
+void report(const char* name, const double ms, const size_t item_count)
+{
+    std::printf(
+        "  %-52s %10.2f ms %10.2f M/s\n",
+        name,
+        ms,
+        ms > 0.0 ? item_count / (ms * 1000.0) : 0.0);
+}
+
+bool check(const bool condition, const char* message)
+{
+    if (!condition)
+        std::printf("  FAILED: %s\n", message);
+
+    return condition;
+}
+
+int main(int argc, char* argv[])
+{
+    bool success = true;
+
+    for (size_t i = 0; i < BenchmarkCount; ++i)
+    {
+        const Benchmark& benchmark = Benchmarks[i];
+
+        if (!is_selected(benchmark.m_name, argc, argv))
+            continue;
+
+        std::printf("%s\n", benchmark.m_name);
+
+        if (!benchmark.m_run())
+            success = false;
+    }
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed-max headers.
+#include "appleseedrenderer/meshconversion.h"
+#include "bench.h"
+
+// appleseed.foundation headers.
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cstddef>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace asf = foundation;
+
+//
+// Compare material slot lookups in MaterialSlotMap with lookups in the std::map that mesh
+// conversion used to build, for dense material IDs and for sparse ones.
+//
+
+namespace
+{
+    const size_t LookupCount = 4 * 1024 * 1024;
+
+    typedef std::map<asf::uint16, asf::uint32> SlotMap;
+
+    // Assign slots to `mtlids` in order of first appearance, as mesh conversion does.
+    void build_maps(
+        const std::vector<asf::uint16>&     mtlids,
+        MaterialSlotMap&                    slot_map,
+        SlotMap&                            reference)
+    {
+        for (const auto mtlid : mtlids)
+        {
+            if (reference.find(mtlid) == reference.end())
+            {
+                const asf::uint32 slot = static_cast<asf::uint32>(reference.size());
+                reference.insert(std::make_pair(mtlid, slot));
+                slot_map.insert(mtlid, slot);
+            }
+        }
+    }
+
+    // Material IDs of `count` triangles drawn from `distinct_count` IDs spaced `stride` apart.
+    std::vector<asf::uint16> make_test_mtlids(
+        const size_t                        count,
+        const size_t                        distinct_count,
+        const size_t                        stride)
+    {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<size_t> dist(0, distinct_count - 1);
+
+        std::vector<asf::uint16> mtlids(count);
+        for (auto& mtlid : mtlids)
+            mtlid = static_cast<asf::uint16>(dist(rng) * stride);
+
+        return mtlids;
+    }
+
+    bool run_lookup_benchmark(
+        const char*                         label,
+        const size_t                        distinct_count,
+        const size_t                        stride)
+    {
+        const std::vector<asf::uint16> mtlids = make_test_mtlids(LookupCount, distinct_count, stride);
+
+        MaterialSlotMap slot_map;
+        SlotMap reference;
+        build_maps(mtlids, slot_map, reference);
+
+        std::vector<asf::uint32> slots(LookupCount);
+        std::vector<asf::uint32> reference_slots(LookupCount);
+
+        const double map_ms =
+            measure_ms([&]()
+            {
+                for (size_t i = 0; i < LookupCount; ++i)
+                    reference_slots[i] = reference.find(mtlids[i])->second;
+            });
+        report((std::string(label) + ", std::map").c_str(), map_ms, LookupCount);
+
+        const double slot_map_ms =
+            measure_ms([&]()
+            {
+                for (size_t i = 0; i < LookupCount; ++i)
+                    slots[i] = slot_map.get_slot(mtlids[i]);
+            });
+        report((std::string(label) + ", MaterialSlotMap").c_str(), slot_map_ms, LookupCount);
+
+        bool success = true;
+
+        if (!check(slots == reference_slots, "MaterialSlotMap returned a wrong slot"))
+            success = false;
+
+        // Entries must come in insertion order, that is, by increasing slot.
+        const std::vector<MaterialSlotMap::Entry>& entries = slot_map.entries();
+        bool in_order = entries.size() == reference.size();
+        for (size_t i = 0, e = entries.size(); in_order && i < e; ++i)
+        {
+            in_order =
+                entries[i].second == i &&
+                reference.find(entries[i].first)->second == entries[i].second;
+        }
+        if (!check(in_order, "MaterialSlotMap::entries() is not in insertion order"))
+            success = false;
+
+        // Material IDs without a slot, below and above the dense limit.
+        if (!check(
+                slot_map.get_slot(static_cast<asf::uint16>(stride * distinct_count + 1)) == MaterialSlotMap::InvalidSlot &&
+                slot_map.get_slot(static_cast<asf::uint16>(65535)) == MaterialSlotMap::InvalidSlot,
+                "MaterialSlotMap returned a slot for an unknown material ID"))
+            success = false;
+
+        return success;
+    }
+}
+
+bool run_material_slot_map_benchmarks()
+{
+    bool success = true;
+
+    // A few dense material IDs, as with most multi/sub-object materials.
+    if (!run_lookup_benchmark("16 dense material IDs", 16, 1))
+        success = false;
+
+    // Material IDs spread over the whole range, most of them above the dense limit.
+    if (!run_lookup_benchmark("64 sparse material IDs", 64, 1000))
+        success = false;
+
+    return success;
+}
@@ -0,0 +1,223 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed-max headers.
+#include "appleseedrenderer/meshconversion.h"
+#include "bench.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace asf = foundation;
+
+//
+// Convert batches of synthetic meshes with execute_mesh_conversion_jobs(), on a single thread
+// and on all cores, and check that both produce the same mesh objects.
+//
+
+namespace
+{
+    const size_t JobCount = 64;
+    const size_t GridSize = 96;         // quads per side of each mesh
+    const size_t RunCount = 3;
+
+    // A wavy grid with faceted vertex normals and texture coordinates per triangle corner, as
+    // snapshots of meshes without smoothing groups have. Welding merges most of them.
+    void make_grid_snapshot(const size_t seed, MeshSnapshot& snapshot)
+    {
+        const size_t row = GridSize + 1;
+
+        for (size_t y = 0; y <= GridSize; ++y)
+        {
+            for (size_t x = 0; x <= GridSize; ++x)
+            {
+                const float h = static_cast<float>((x * 7 + y * 13 + seed) % 17) * 0.01f;
+                snapshot.m_vertices.push_back(asf::Vector3f(static_cast<float>(x), static_cast<float>(y), h));
+            }
+        }
+
+        for (size_t y = 0; y < GridSize; ++y)
+        {
+            for (size_t x = 0; x < GridSize; ++x)
+            {
+                const asf::uint32 v00 = static_cast<asf::uint32>(y * row + x);
+                const asf::uint32 v10 = v00 + 1;
+                const asf::uint32 v01 = v00 + static_cast<asf::uint32>(row);
+                const asf::uint32 v11 = v01 + 1;
+
+                const asf::uint32 corners[2][3] = { { v00, v10, v11 }, { v00, v11, v01 } };
+                for (size_t t = 0; t < 2; ++t)
+                {
+                    const asf::uint32 first = static_cast<asf::uint32>(snapshot.m_vertex_normals.size());
+                    for (size_t c = 0; c < 3; ++c)
+                    {
+                        snapshot.m_vertex_normals.push_back(asf::Vector3f(0.0f, 0.0f, 1.0f));
+
+                        const asf::uint32 v = corners[t][c];
+                        snapshot.m_tex_coords.push_back(
+                            asf::Vector2f(
+                                static_cast<float>(v % row) / GridSize,
+                                static_cast<float>(v / row) / GridSize));
+                    }
+
+                    MeshSnapshot::Triangle triangle;
+                    triangle.m_v0 = corners[t][0];
+                    triangle.m_v1 = corners[t][1];
+                    triangle.m_v2 = corners[t][2];
+                    triangle.m_n0 = triangle.m_a0 = first;
+                    triangle.m_n1 = triangle.m_a1 = first + 1;
+                    triangle.m_n2 = triangle.m_a2 = first + 2;
+                    triangle.m_mtlid = static_cast<asf::uint16>((x / 8 + y / 8) % 4);
+                    snapshot.m_triangles.push_back(triangle);
+                }
+            }
+        }
+    }
+
+    void make_jobs(
+        const MeshConversionParams&     params,
+        MeshConversionJobs&             jobs)
+    {
+        jobs.clear();
+
+        for (size_t i = 0; i < JobCount; ++i)
+        {
+            std::unique_ptr<MeshConversionJob> job(new MeshConversionJob());
+            job->m_name = "mesh_" + std::to_string(static_cast<unsigned long long>(i));
+            job->m_params = params;
+            make_grid_snapshot(i, job->m_snapshot);
+            jobs.push_back(std::move(job));
+        }
+    }
+
+    // Execute fresh jobs a few times and return the duration of the fastest execution in
+    // milliseconds. Snapshots are taken outside of the timed section.
+    double measure_conversion_ms(
+        const MeshConversionParams&     params,
+        const size_t                    thread_count,
+        MeshConversionJobs&             jobs)
+    {
+        double best_ms = 0.0;
+
+        for (size_t i = 0; i < RunCount; ++i)
+        {
+            make_jobs(params, jobs);
+
+            std::vector<MeshConversionJob*> job_ptrs;
+            for (const auto& job : jobs)
+                job_ptrs.push_back(job.get());
+
+            const auto begin = std::chrono::high_resolution_clock::now();
+            execute_mesh_conversion_jobs(job_ptrs, thread_count);
+            const auto end = std::chrono::high_resolution_clock::now();
+
+            const double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+            if (i == 0 || ms < best_ms)
+                best_ms = ms;
+        }
+
+        return best_ms;
+    }
+
+    size_t count_triangles(const MeshConversionJobs& jobs)
+    {
+        size_t triangle_count = 0;
+
+        for (const auto& job : jobs)
+            triangle_count += job->m_stats.m_triangle_count;
+
+        return triangle_count;
+    }
+
+    bool run_conversion_benchmark(
+        const char*                     label,
+        const MeshConversionParams&     params)
+    {
+        const size_t core_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+        MeshConversionJobs serial_jobs;
+        const double serial_ms = measure_conversion_ms(params, 1, serial_jobs);
+        report((std::string(label) + ", 1 thread").c_str(), serial_ms, count_triangles(serial_jobs));
+
+        MeshConversionJobs parallel_jobs;
+        const double parallel_ms = measure_conversion_ms(params, core_count, parallel_jobs);
+        report(
+            (std::string(label) + ", " + std::to_string(static_cast<unsigned long long>(core_count)) + " threads").c_str(),
+            parallel_ms,
+            count_triangles(parallel_jobs));
+
+        // Jobs store their own results, so the order of execution must not matter.
+        bool identical = serial_jobs.size() == parallel_jobs.size();
+        for (size_t i = 0, e = serial_jobs.size(); identical && i < e; ++i)
+        {
+            const MeshConversionJob& serial_job = *serial_jobs[i];
+            const MeshConversionJob& parallel_job = *parallel_jobs[i];
+
+            identical =
+                serial_job.m_object.get() != nullptr &&
+                parallel_job.m_object.get() != nullptr &&
+                serial_job.m_stats.m_triangle_count == parallel_job.m_stats.m_triangle_count &&
+                serial_job.m_stats.m_output_vertex_normal_count == parallel_job.m_stats.m_output_vertex_normal_count &&
+                compute_content_hash(*serial_job.m_object) == compute_content_hash(*parallel_job.m_object);
+        }
+
+        return check(identical, "parallel mesh conversion produced different mesh objects");
+    }
+}
+
+bool run_mesh_conversion_benchmarks()
+{
+    bool success = true;
+
+    MeshConversionParams params;
+    params.m_optimize = true;
+
+    params.m_weld_vertex_attributes = false;
+    if (!run_conversion_benchmark("optimize", params))
+        success = false;
+
+    params.m_weld_vertex_attributes = true;
+    if (!run_conversion_benchmark("weld + optimize", params))
+        success = false;
+
+    params.m_subdivision_iterations = 1;
+    if (!run_conversion_benchmark("subdivide + weld + optimize", params))
+        success = false;
+
+    return success;
+}
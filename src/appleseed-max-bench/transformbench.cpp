@@ -0,0 +1,156 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed-max headers.
+#include "appleseedrenderer/meshconversion.h"
+#include "bench.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/matrix.h"
+#include "foundation/math/transform.h"
+#include "foundation/math/vector.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+namespace asf = foundation;
+
+//
+// Compare transform_points() and transform_normals() with transforming vectors one at a
+// time through foundation::Transformf, as mesh conversion used to do.
+//
+
+namespace
+{
+    const size_t VectorCount = 1024 * 1024;
+
+    asf::Transformf make_test_transform()
+    {
+        const asf::Matrix4f m =
+            asf::Matrix4f::make_translation(asf::Vector3f(1.0f, -2.0f, 3.0f)) *
+            asf::Matrix4f::make_rotation(asf::normalize(asf::Vector3f(1.0f, 2.0f, 3.0f)), 0.7f) *
+            asf::Matrix4f::make_scaling(asf::Vector3f(2.0f, 0.5f, 1.5f));
+
+        return asf::Transformf::from_local_to_parent(m);
+    }
+
+    std::vector<asf::Vector3f> make_test_vectors(const size_t count, const unsigned int seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+
+        std::vector<asf::Vector3f> vectors(count);
+        for (auto& v : vectors)
+        {
+            v.x = dist(rng);
+            v.y = dist(rng);
+            v.z = dist(rng);
+        }
+
+        // Zero-length normals must go through safe_normalize() on both paths.
+        for (size_t i = 0; i < count; i += 1000)
+            vectors[i] = asf::Vector3f(0.0f);
+
+        return vectors;
+    }
+
+    float max_difference(const std::vector<asf::Vector3f>& lhs, const std::vector<asf::Vector3f>& rhs)
+    {
+        float result = 0.0f;
+
+        for (size_t i = 0, e = lhs.size(); i < e; ++i)
+        {
+            for (size_t j = 0; j < 3; ++j)
+            {
+                const float scale = std::max(std::abs(lhs[i][j]), 1.0f);
+                result = std::max(result, std::abs(lhs[i][j] - rhs[i][j]) / scale);
+            }
+        }
+
+        return result;
+    }
+}
+
+bool run_transform_benchmarks()
+{
+    const asf::Transformf transform = make_test_transform();
+    const std::vector<asf::Vector3f> input = make_test_vectors(VectorCount, 42);
+
+    std::vector<asf::Vector3f> scalar_output(VectorCount);
+    std::vector<asf::Vector3f> batch_output(VectorCount);
+
+    // Points.
+    const double scalar_points_ms =
+        measure_ms([&]()
+        {
+            for (size_t i = 0; i < VectorCount; ++i)
+                scalar_output[i] = transform.point_to_parent(input[i]);
+        });
+    report("points, one at a time", scalar_points_ms, VectorCount);
+
+    const double batch_points_ms =
+        measure_ms([&]()
+        {
+            transform_points(transform, &input[0], &batch_output[0], VectorCount);
+        });
+    report("points, transform_points()", batch_points_ms, VectorCount);
+
+    bool success = true;
+
+    if (!check(
+            max_difference(scalar_output, batch_output) < 1.0e-5f,
+            "transform_points() differs from Transformf::point_to_parent()"))
+        success = false;
+
+    // Normals.
+    const double scalar_normals_ms =
+        measure_ms([&]()
+        {
+            for (size_t i = 0; i < VectorCount; ++i)
+                scalar_output[i] = asf::safe_normalize(transform.normal_to_parent(input[i]));
+        });
+    report("normals, one at a time", scalar_normals_ms, VectorCount);
+
+    const double batch_normals_ms =
+        measure_ms([&]()
+        {
+            transform_normals(transform, &input[0], &batch_output[0], VectorCount);
+        });
+    report("normals, transform_normals()", batch_normals_ms, VectorCount);
+
+    if (!check(
+            max_difference(scalar_output, batch_output) < 1.0e-5f,
+            "transform_normals() differs from Transformf::normal_to_parent()"))
+        success = false;
+
+    return success;
+}
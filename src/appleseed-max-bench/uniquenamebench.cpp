@@ -0,0 +1,156 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed-max headers.
+#include "bench.h"
+#include "uniquenameregistry.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/scene.h"
+#include "renderer/api/utility.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/transform.h"
+#include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/containers/dictionary.h"
+
+// Standard headers.
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace asf = foundation;
+namespace asr = renderer;
+
+//
+// Compare UniqueNameRegistry with the way make_unique_name() used to generate names, by
+// scanning the container for the highest numeric suffix, when many object instances are
+// created from identically named nodes.
+//
+
+namespace
+{
+    const size_t ScanningInstanceCount = 10 * 1000;
+    const size_t RegistryInstanceCount = 100 * 1000;
+
+    const char* InstanceName = "Box001_inst";
+
+    std::string make_unique_name_by_scanning(
+        const asr::ObjectInstanceContainer& entities,
+        const std::string&                  name)
+    {
+        return
+            entities.get_by_name(name.c_str()) == nullptr
+                ? name
+                : asr::make_unique_name(name + "_", entities);
+    }
+
+    void insert_object_instance(
+        asr::Assembly&                      assembly,
+        const std::string&                  name)
+    {
+        assembly.object_instances().insert(
+            asr::ObjectInstanceFactory::create(
+                name.c_str(),
+                asr::ParamArray(),
+                "object",
+                asf::Transformd::identity(),
+                asf::StringDictionary(),
+                asf::StringDictionary()));
+    }
+
+    // Create `count` object instances with the same base name, and return their names.
+    template <typename MakeUniqueName>
+    std::vector<std::string> create_object_instances(
+        const size_t                        count,
+        MakeUniqueName                      make_unique_name)
+    {
+        asf::auto_release_ptr<asr::Assembly> assembly(asr::AssemblyFactory().create("assembly"));
+
+        std::vector<std::string> names;
+        names.reserve(count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            names.push_back(make_unique_name(assembly->object_instances(), InstanceName));
+            insert_object_instance(assembly.ref(), names.back());
+        }
+
+        return names;
+    }
+}
+
+bool run_unique_name_benchmarks()
+{
+    std::vector<std::string> scanning_names;
+    const double scanning_ms =
+        measure_ms([&]()
+        {
+            scanning_names =
+                create_object_instances(
+                    ScanningInstanceCount,
+                    [](const asr::ObjectInstanceContainer& entities, const std::string& name)
+                    {
+                        return make_unique_name_by_scanning(entities, name);
+                    });
+        }, 1);
+    report("10K names, scanning the container", scanning_ms, ScanningInstanceCount);
+
+    std::vector<std::string> registry_names;
+    const double registry_ms =
+        measure_ms([&]()
+        {
+            UniqueNameRegistry registry;
+            registry_names =
+                create_object_instances(
+                    ScanningInstanceCount,
+                    [&registry](const asr::ObjectInstanceContainer& entities, const std::string& name)
+                    {
+                        return registry.make_unique_name(entities, name);
+                    });
+        }, 1);
+    report("10K names, UniqueNameRegistry", registry_ms, ScanningInstanceCount);
+
+    const double large_registry_ms =
+        measure_ms([&]()
+        {
+            UniqueNameRegistry registry;
+            create_object_instances(
+                RegistryInstanceCount,
+                [&registry](const asr::ObjectInstanceContainer& entities, const std::string& name)
+                {
+                    return registry.make_unique_name(entities, name);
+                });
+        }, 1);
+    report("100K names, UniqueNameRegistry", large_registry_ms, RegistryInstanceCount);
+
+    return
+        check(
+            registry_names == scanning_names,
+            "UniqueNameRegistry generated different names than scanning the container");
+}
@@ -39,6 +39,7 @@
 #include "appleseedrenderer/appleseedrenderer.h"
 #include "bump/bumpparammapdlgproc.h"
 #include "bump/resource.h"
+#include "exprformatter.h"
 #include "main.h"
 #include "oslutils.h"
 #include "utilities.h"
@@ -600,6 +601,7 @@ asf::auto_release_ptr<asr::Material> AppleseedBlendMtl::create_osl_material(
     const TimeValue time = GetCOREInterface()->GetTime();
     
     asr::ParamArray shader_params;
+    ExprFormatter formatter;
     int layer_index = 1;
 
     for (int i = 0, e = m_pblock->Count(ParamIdLayerMtl); i < e; ++i)
@@ -625,7 +627,7 @@ asf::auto_release_ptr<asr::Material> AppleseedBlendMtl::create_osl_material(
         }
 
         shader_params.insert(
-            asf::format("MixAmount_{0}", layer_index).c_str(), fmt_osl_expr(mask_amount));
+            asf::format("MixAmount_{0}", layer_index).c_str(), formatter.osl(mask_amount));
 
         ++layer_index;
     }
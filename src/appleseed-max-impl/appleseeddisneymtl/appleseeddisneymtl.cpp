@@ -35,6 +35,7 @@
 #include "appleseedrenderer/appleseedrenderer.h"
 #include "bump/bumpparammapdlgproc.h"
 #include "bump/resource.h"
+#include "exprformatter.h"
 #include "main.h"
 #include "oslutils.h"
 #include "utilities.h"
@@ -764,18 +765,20 @@ asf::auto_release_ptr<asr::Material> AppleseedDisneyMtl::create_osl_material(
         }
     }
 
-    shader_group->add_shader("surface", "as_max_disney_material", name, 
-        asr::ParamArray()
-            .insert("BaseColor", fmt_osl_expr(to_color3f(m_base_color)))
-            .insert("Metallic", fmt_osl_expr(m_metallic / 100.0f))
-            .insert("Specular", fmt_osl_expr(m_specular / 100.0f))
-            .insert("SpecularTint", fmt_osl_expr(m_specular_tint / 100.0f))
-            .insert("Roughness", fmt_osl_expr(m_roughness / 100.0f))
-            .insert("Sheen", fmt_osl_expr(m_sheen / 100.0f))
-            .insert("SheenTint", fmt_osl_expr(m_sheen_tint / 100.0f))
-            .insert("Anisotropic", fmt_osl_expr(m_anisotropy))
-            .insert("Clearcoat", fmt_osl_expr(m_clearcoat / 100.0f))
-            .insert("ClearcoatGloss", fmt_osl_expr(m_clearcoat_gloss / 100.0f)));
+    // Each parameter is inserted before the next one is formatted: the formatter reuses its buffer.
+    ExprFormatter formatter;
+    asr::ParamArray surface_params;
+    surface_params.insert("BaseColor", formatter.osl(to_color3f(m_base_color)));
+    surface_params.insert("Metallic", formatter.osl(m_metallic / 100.0f));
+    surface_params.insert("Specular", formatter.osl(m_specular / 100.0f));
+    surface_params.insert("SpecularTint", formatter.osl(m_specular_tint / 100.0f));
+    surface_params.insert("Roughness", formatter.osl(m_roughness / 100.0f));
+    surface_params.insert("Sheen", formatter.osl(m_sheen / 100.0f));
+    surface_params.insert("SheenTint", formatter.osl(m_sheen_tint / 100.0f));
+    surface_params.insert("Anisotropic", formatter.osl(m_anisotropy));
+    surface_params.insert("Clearcoat", formatter.osl(m_clearcoat / 100.0f));
+    surface_params.insert("ClearcoatGloss", formatter.osl(m_clearcoat_gloss / 100.0f));
+    shader_group->add_shader("surface", "as_max_disney_material", name, surface_params);
 
     std::string closure2surface_name = asf::format("{0}_closure2surface", name);
     shader_group.ref().add_shader("shader", "as_max_closure2surface", closure2surface_name.c_str(), asr::ParamArray());
@@ -35,6 +35,7 @@
 #include "appleseedrenderer/appleseedrenderer.h"
 #include "bump/bumpparammapdlgproc.h"
 #include "bump/resource.h"
+#include "exprformatter.h"
 #include "main.h"
 #include "oslutils.h"
 #include "utilities.h"
@@ -681,17 +682,19 @@ asf::auto_release_ptr<asr::Material> AppleseedGlassMtl::create_osl_material(
         }
     }
 
-    shader_group->add_shader("surface", "as_max_glass_material", name, 
-        asr::ParamArray()
-            .insert("SurfaceTransmittance", fmt_osl_expr(to_color3f(m_surface_color)))
-            .insert("ReflectionTint", fmt_osl_expr(to_color3f(m_reflection_tint)))
-            .insert("RefractionTint", fmt_osl_expr(to_color3f(m_refraction_tint)))
-            .insert("VolumeTransmittance", fmt_osl_expr(to_color3f(m_volume_color)))
-            .insert("Roughness", fmt_osl_expr(m_roughness / 100.0f))
-            .insert("Anisotropic", fmt_osl_expr(m_anisotropy / 100.0f))
-            .insert("Ior", fmt_osl_expr(m_ior))
-            .insert("VolumeTransmittanceDistance", fmt_osl_expr(m_scale))
-            .insert("Distribution", fmt_osl_expr("ggx")));
+    // Each parameter is inserted before the next one is formatted: the formatter reuses its buffer.
+    ExprFormatter formatter;
+    asr::ParamArray surface_params;
+    surface_params.insert("SurfaceTransmittance", formatter.osl(to_color3f(m_surface_color)));
+    surface_params.insert("ReflectionTint", formatter.osl(to_color3f(m_reflection_tint)));
+    surface_params.insert("RefractionTint", formatter.osl(to_color3f(m_refraction_tint)));
+    surface_params.insert("VolumeTransmittance", formatter.osl(to_color3f(m_volume_color)));
+    surface_params.insert("Roughness", formatter.osl(m_roughness / 100.0f));
+    surface_params.insert("Anisotropic", formatter.osl(m_anisotropy / 100.0f));
+    surface_params.insert("Ior", formatter.osl(m_ior));
+    surface_params.insert("VolumeTransmittanceDistance", formatter.osl(m_scale));
+    surface_params.insert("Distribution", formatter.osl("ggx"));
+    shader_group->add_shader("surface", "as_max_glass_material", name, surface_params);
 
     std::string closure2surface_name = asf::format("{0}_closure2surface", name);
     shader_group.ref().add_shader("shader", "as_max_closure2surface", closure2surface_name.c_str(), asr::ParamArray());
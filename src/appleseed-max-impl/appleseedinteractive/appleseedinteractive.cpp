@@ -348,11 +348,14 @@ asf::auto_release_ptr<asr::Project> AppleseedInteractiveRender::prepare_project(
 
     m_entities.clear();
 
-    MaxSceneEntityCollector collector(m_entities);
+    MaxSceneEntityCollector collector(m_entities, time);
     collector.collect(m_scene_inode);
 
     // Call RenderBegin() on all object instances.
-    render_begin(m_entities.m_objects, time);
+    render_begin(m_entities.m_object_candidates, time);
+
+    // Evaluate object instances once, now that they are in render mode.
+    collector.evaluate_objects();
 
     // Build the project.
     if (m_progress_cb)
@@ -369,6 +372,8 @@ asf::auto_release_ptr<asr::Project> AppleseedInteractiveRender::prepare_project(
             renderer_settings,
             m_bitmap,
             time,
+            nullptr,
+            nullptr,
             m_progress_cb));
 
     std::setlocale(LC_ALL, previous_locale.c_str());
@@ -486,7 +491,7 @@ void AppleseedInteractiveRender::EndSession()
         m_render_session.reset(nullptr);
     }
     
-    render_end(m_entities.m_objects, m_time);
+    render_end(m_entities.m_object_candidates, m_time);
 
     if (m_progress_cb)
         m_progress_cb->SetTitle(L"Done.");
@@ -33,6 +33,7 @@
 #include "appleseedlightmtl/datachunks.h"
 #include "appleseedlightmtl/resource.h"
 #include "appleseedrenderer/appleseedrenderer.h"
+#include "exprformatter.h"
 #include "main.h"
 #include "oslutils.h"
 #include "utilities.h"
@@ -509,10 +510,12 @@ asf::auto_release_ptr<asr::Material> AppleseedLightMtl::create_osl_material(
 
     connect_color_texture(shader_group.ref(), name, "Color", m_light_color_texmap, m_light_color);
     
-    shader_group->add_shader("surface", "as_max_light_material", name, 
-        asr::ParamArray()
-            .insert("Color", fmt_osl_expr(to_color3f(m_light_color)))
-            .insert("Emission", fmt_osl_expr(m_light_power)));
+    // Each parameter is inserted before the next one is formatted: the formatter reuses its buffer.
+    ExprFormatter formatter;
+    asr::ParamArray surface_params;
+    surface_params.insert("Color", formatter.osl(to_color3f(m_light_color)));
+    surface_params.insert("Emission", formatter.osl(m_light_power));
+    shader_group->add_shader("surface", "as_max_light_material", name, surface_params);
 
     std::string closure2surface_name = asf::format("{0}_closure2surface", name);
     shader_group.ref().add_shader("shader", "as_max_closure2surface", closure2surface_name.c_str(), asr::ParamArray());
@@ -35,6 +35,7 @@
 #include "appleseedrenderer/appleseedrenderer.h"
 #include "bump/bumpparammapdlgproc.h"
 #include "bump/resource.h"
+#include "exprformatter.h"
 #include "main.h"
 #include "oslutils.h"
 #include "utilities.h"
@@ -660,13 +661,15 @@ asf::auto_release_ptr<asr::Material> AppleseedMetalMtl::create_osl_material(
         }
     }
 
-    shader_group->add_shader("surface", "as_max_metal_material", name, 
-        asr::ParamArray()
-            .insert("NormalReflectance", fmt_osl_expr(to_color3f(m_facing_tint_color)))
-            .insert("EdgeTint", fmt_osl_expr(to_color3f(m_edge_tint_color)))
-            .insert("Reflectance", fmt_osl_expr(m_reflectance / 100.0f))
-            .insert("Roughness", fmt_osl_expr(m_roughness / 100.0f))
-            .insert("Anisotropic", fmt_osl_expr(m_anisotropy)));
+    // Each parameter is inserted before the next one is formatted: the formatter reuses its buffer.
+    ExprFormatter formatter;
+    asr::ParamArray surface_params;
+    surface_params.insert("NormalReflectance", formatter.osl(to_color3f(m_facing_tint_color)));
+    surface_params.insert("EdgeTint", formatter.osl(to_color3f(m_edge_tint_color)));
+    surface_params.insert("Reflectance", formatter.osl(m_reflectance / 100.0f));
+    surface_params.insert("Roughness", formatter.osl(m_roughness / 100.0f));
+    surface_params.insert("Anisotropic", formatter.osl(m_anisotropy));
+    shader_group->add_shader("surface", "as_max_metal_material", name, surface_params);
 
     std::string closure2surface_name = asf::format("{0}_closure2surface", name);
     shader_group.ref().add_shader("shader", "as_max_closure2surface", closure2surface_name.c_str(), asr::ParamArray());
@@ -75,7 +75,9 @@ namespace
         ParamIdVisibilitySpecular       = 7,
         ParamIdVisibilitySSS            = 8,
         ParamIdSSSSet                   = 9,
-        ParamIdOptimizeForInstancing    = 10
+        ParamIdOptimizeForInstancing    = 10,
+        ParamIdSubdivisionIterations    = 11,
+        ParamIdProxyFile                = 12
     };
 
     ParamBlockDesc2 g_block_desc(
@@ -146,6 +148,16 @@ namespace
             p_ui, ParamMapIdVisibility, TYPE_EDITBOX, IDC_SSS_SET,
         p_end,
 
+        ParamIdSubdivisionIterations, L"subdivision_iterations", TYPE_INT, 0, IDS_SUBDIVISION_ITERATIONS,
+            p_default, 0,
+            p_range, 0, 4,
+            p_ui, ParamMapIdVisibility, TYPE_SPINNER, EDITTYPE_INT, IDC_TEXT_SUBDIVISION_ITERATIONS, IDC_SPINNER_SUBDIVISION_ITERATIONS, SPIN_AUTOSCALE,
+        p_end,
+
+        ParamIdProxyFile, L"proxy_file", TYPE_STRING, 0, IDS_PROXY_FILE,
+            p_ui, ParamMapIdVisibility, TYPE_EDITBOX, IDC_TEXT_PROXY_FILE,
+        p_end,
+
         // --- The end ---
         p_end);
 }
@@ -352,6 +364,18 @@ std::string AppleseedObjPropsMod::get_sss_set(const TimeValue t) const
     return str_value != nullptr ? wide_to_utf8(str_value) : std::string();
 }
 
+int AppleseedObjPropsMod::get_subdivision_iterations(const TimeValue t) const
+{
+    return m_pblock->GetInt(ParamIdSubdivisionIterations, t, FOREVER);
+}
+
+std::string AppleseedObjPropsMod::get_proxy_file(const TimeValue t) const
+{
+    const MCHAR* str_value;
+    m_pblock->GetValue(ParamIdProxyFile, t, str_value, FOREVER);
+    return str_value != nullptr ? wide_to_utf8(str_value) : std::string();
+}
+
 
 //
 // AppleseedObjPropsModClassDesc class implementation.
@@ -95,6 +95,12 @@ class AppleseedObjPropsMod
     renderer::VisibilityFlags::Type get_visibility_flags(const TimeValue t) const;
     std::string get_sss_set(const TimeValue t) const;
 
+    // Number of subdivision iterations applied to the mesh when the scene is exported.
+    int get_subdivision_iterations(const TimeValue t) const;
+
+    // Path to a mesh file rendered in place of the object, or an empty string.
+    std::string get_proxy_file(const TimeValue t) const;
+
   private:
     IParamBlock2*   m_pblock;
 };
@@ -38,6 +38,15 @@
 #define IDC_BUTTON_OPTIMIZE_FOR_INSTANCING  7101
 #define IDS_OPTIMIZE_FOR_INSTANCING         7102
 
+#define IDC_TEXT_SUBDIVISION_ITERATIONS     7110
+#define IDC_SPINNER_SUBDIVISION_ITERATIONS  7111
+#define IDS_SUBDIVISION_ITERATIONS          7112
+#define IDC_SUBDIVISION_ITERATIONS_LABEL    7113
+
+#define IDC_TEXT_PROXY_FILE                 7120
+#define IDS_PROXY_FILE                      7121
+#define IDC_PROXY_FILE_LABEL                7122
+
 // Next default values for new objects
 // 
 #ifdef APSTUDIO_INVOKED
@@ -35,6 +35,7 @@
 #include "appleseedrenderer/appleseedrenderer.h"
 #include "bump/bumpparammapdlgproc.h"
 #include "bump/resource.h"
+#include "exprformatter.h"
 #include "main.h"
 #include "oslutils.h"
 #include "utilities.h"
@@ -681,16 +682,18 @@ asf::auto_release_ptr<asr::Material> AppleseedPlasticMtl::create_osl_material(
         }
     }
 
-    shader_group->add_shader("surface", "as_max_plastic_material", name, 
-        asr::ParamArray()
-            .insert("SpecularColor", fmt_osl_expr(to_color3f(m_specular)))
-            .insert("SpecularWeight", fmt_osl_expr(m_specular_weight / 100.0f))
-            .insert("DiffuseColor", fmt_osl_expr(to_color3f(m_diffuse)))
-            .insert("DiffuseWeight", fmt_osl_expr(m_diffuse_weight / 100.0f))
-            .insert("Roughness", fmt_osl_expr(m_roughness / 100.0f))
-            .insert("Spread", fmt_osl_expr(m_highlight_falloff / 100.0f))
-            .insert("Scattering", fmt_osl_expr(m_scattering / 100.0f))
-            .insert("IOR", fmt_osl_expr(m_ior)));
+    // Each parameter is inserted before the next one is formatted: the formatter reuses its buffer.
+    ExprFormatter formatter;
+    asr::ParamArray surface_params;
+    surface_params.insert("SpecularColor", formatter.osl(to_color3f(m_specular)));
+    surface_params.insert("SpecularWeight", formatter.osl(m_specular_weight / 100.0f));
+    surface_params.insert("DiffuseColor", formatter.osl(to_color3f(m_diffuse)));
+    surface_params.insert("DiffuseWeight", formatter.osl(m_diffuse_weight / 100.0f));
+    surface_params.insert("Roughness", formatter.osl(m_roughness / 100.0f));
+    surface_params.insert("Spread", formatter.osl(m_highlight_falloff / 100.0f));
+    surface_params.insert("Scattering", formatter.osl(m_scattering / 100.0f));
+    surface_params.insert("IOR", formatter.osl(m_ior));
+    shader_group->add_shader("surface", "as_max_plastic_material", name, surface_params);
 
     std::string closure2surface_name = asf::format("{0}_closure2surface", name);
     shader_group.ref().add_shader("shader", "as_max_closure2surface", closure2surface_name.c_str(), asr::ParamArray());
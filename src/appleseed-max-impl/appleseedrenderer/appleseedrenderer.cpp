@@ -36,6 +36,7 @@
 #include "appleseedrenderer/datachunks.h"
 #include "appleseedrenderer/dialoglogtarget.h"
 #include "appleseedrenderer/projectbuilder.h"
+#include "appleseedrenderer/projectwriter.h"
 #include "appleseedrenderer/renderercontroller.h"
 #include "appleseedrenderer/tilecallback.h"
 #include "main.h"
@@ -49,6 +50,7 @@
 #include "renderer/api/rendering.h"
 
 // appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
 #include "foundation/image/canvasproperties.h"
 #include "foundation/image/image.h"
 #include "foundation/platform/thread.h"
@@ -84,7 +86,8 @@ namespace
         ParamMapIdOutput,
         ParamMapIdImageSampling,
         ParamMapIdLighting,
-        ParamMapIdSystem
+        ParamMapIdSystem,
+        ParamMapIdSceneExport
     };
 
     enum ParamId
@@ -115,6 +118,22 @@ namespace
         ParamIdEnableLowPriority        = 20,
         ParamIdEnableRenderStamp        = 21,
         ParamIdRenderStampFormat        = 22,
+
+        ParamIdParallelMeshConversion   = 23,
+        ParamIdWeldVertexAttributes     = 24,
+        ParamIdWeldTolerance            = 25,
+        ParamIdCacheGeometry            = 26,
+        ParamIdOptimizeMeshes           = 27,
+        ParamIdAutoInstancing           = 28,
+        ParamIdAutoAssemblyInstancing   = 29,
+        ParamIdAssemblyInstThreshold    = 30,
+        ParamIdBinaryMeshFiles          = 31,
+        ParamIdSplineCurves             = 32,
+        ParamIdMotionBlur               = 33,
+        ParamIdMotionSamples            = 34,
+        ParamIdShutterDuration          = 35,
+        ParamIdDeformationBlur          = 36,
+        ParamIdCacheMaterials           = 37,
     };
     
     const asf::KeyValuePair<int, const wchar_t*> g_dialog_strings[] =
@@ -214,6 +233,10 @@ void AppleseedRendererPBlockAccessor::Get(
       case ParamIdScaleMultiplier:
         v.f = settings.m_scale_multiplier;
         break;
+
+      case ParamIdBinaryMeshFiles:
+        v.i = static_cast<int>(settings.m_binary_mesh_files);
+        break;
         
       //
       // Image Sampling.
@@ -311,6 +334,66 @@ void AppleseedRendererPBlockAccessor::Get(
         v.i = static_cast<int>(settings.m_log_open_mode);
         break;
 
+      //
+      // Scene Export.
+      //
+
+      case ParamIdParallelMeshConversion:
+        v.i = static_cast<int>(settings.m_parallel_mesh_conversion);
+        break;
+
+      case ParamIdWeldVertexAttributes:
+        v.i = static_cast<int>(settings.m_weld_vertex_attributes);
+        break;
+
+      case ParamIdWeldTolerance:
+        v.f = settings.m_weld_tolerance;
+        break;
+
+      case ParamIdCacheGeometry:
+        v.i = static_cast<int>(settings.m_cache_geometry);
+        break;
+
+      case ParamIdOptimizeMeshes:
+        v.i = static_cast<int>(settings.m_optimize_meshes);
+        break;
+
+      case ParamIdAutoInstancing:
+        v.i = static_cast<int>(settings.m_auto_instancing);
+        break;
+
+      case ParamIdAutoAssemblyInstancing:
+        v.i = static_cast<int>(settings.m_auto_assembly_instancing);
+        break;
+
+      case ParamIdAssemblyInstThreshold:
+        v.i = settings.m_assembly_instancing_threshold;
+        break;
+
+      case ParamIdSplineCurves:
+        v.i = static_cast<int>(settings.m_spline_curves);
+        break;
+
+      case ParamIdMotionBlur:
+        v.i = static_cast<int>(settings.m_motion_blur);
+        break;
+
+      case ParamIdMotionSamples:
+        v.i = settings.m_motion_samples;
+        break;
+
+      case ParamIdShutterDuration:
+        v.f = settings.m_shutter_duration;
+        break;
+
+      case ParamIdDeformationBlur:
+        v.i = static_cast<int>(settings.m_deformation_blur);
+        break;
+
+      case ParamIdCacheMaterials:
+        v.i = static_cast<int>(settings.m_cache_materials);
+        break;
+
       default:
         break;
     }
@@ -339,6 +422,10 @@ void AppleseedRendererPBlockAccessor::Set(
       case ParamIdScaleMultiplier:
         settings.m_scale_multiplier = v.f;
         break;
+
+      case ParamIdBinaryMeshFiles:
+        settings.m_binary_mesh_files = v.i > 0;
+        break;
         
     //
     // Image Sampling.
@@ -436,6 +523,66 @@ void AppleseedRendererPBlockAccessor::Set(
         settings.m_log_open_mode = static_cast<DialogLogTarget::OpenMode>(v.i);
         break;
 
+    //
+    // Scene Export.
+    //
+
+      case ParamIdParallelMeshConversion:
+        settings.m_parallel_mesh_conversion = v.i > 0;
+        break;
+
+      case ParamIdWeldVertexAttributes:
+        settings.m_weld_vertex_attributes = v.i > 0;
+        break;
+
+      case ParamIdWeldTolerance:
+        settings.m_weld_tolerance = v.f;
+        break;
+
+      case ParamIdCacheGeometry:
+        settings.m_cache_geometry = v.i > 0;
+        break;
+
+      case ParamIdOptimizeMeshes:
+        settings.m_optimize_meshes = v.i > 0;
+        break;
+
+      case ParamIdAutoInstancing:
+        settings.m_auto_instancing = v.i > 0;
+        break;
+
+      case ParamIdAutoAssemblyInstancing:
+        settings.m_auto_assembly_instancing = v.i > 0;
+        break;
+
+      case ParamIdAssemblyInstThreshold:
+        settings.m_assembly_instancing_threshold = v.i;
+        break;
+
+      case ParamIdSplineCurves:
+        settings.m_spline_curves = v.i > 0;
+        break;
+
+      case ParamIdMotionBlur:
+        settings.m_motion_blur = v.i > 0;
+        break;
+
+      case ParamIdMotionSamples:
+        settings.m_motion_samples = v.i;
+        break;
+
+      case ParamIdShutterDuration:
+        settings.m_shutter_duration = v.f;
+        break;
+
+      case ParamIdDeformationBlur:
+        settings.m_deformation_blur = v.i > 0;
+        break;
+
+      case ParamIdCacheMaterials:
+        settings.m_cache_materials = v.i > 0;
+        break;
+
       default:
         break;
     }
@@ -466,7 +613,7 @@ ParamBlockDesc2 g_param_block_desc(
     0,                                          // parameter block's reference number
 
                                                 // --- P_MULTIMAP arguments ---
-    4,
+    5,
 
     // --- P_AUTO_UI arguments for Parameters rollup ---
 
@@ -498,6 +645,13 @@ ParamBlockDesc2 g_param_block_desc(
     0,                                          // rollup creation flag
     nullptr,
 
+    ParamMapIdSceneExport,
+    IDD_FORMVIEW_RENDERERPARAMS_SCENEEXPORT,    // ID of the dialog template
+    0,                                          // ID of the dialog's title string
+    0,                                          // IParamMap2 creation/deletion flag mask
+    0,                                          // rollup creation flag
+    nullptr,
+
     // --- Parameters specifications for Output rollup ---
 
     ParamIdOuputMode, L"output_mode", TYPE_INT, P_TRANSIENT, 0,
@@ -517,6 +671,12 @@ ParamBlockDesc2 g_param_block_desc(
         p_accessor, &g_pblock_accessor,
     p_end,
 
+    ParamIdBinaryMeshFiles, L"binary_mesh_files", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdOutput, TYPE_SINGLECHEKBOX, IDC_CHECK_BINARY_MESH_FILES,
+        p_default, FALSE,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
     // --- Parameters specifications for Image Sampling rollup ---
 
     ParamIdPixelSamples, L"pixel_samples", TYPE_INT, P_TRANSIENT, 0,
@@ -659,6 +819,99 @@ ParamBlockDesc2 g_param_block_desc(
         p_default, L"appleseed {lib-version} | Time: {render-time}",
         p_accessor, &g_pblock_accessor,
     p_end,
+
+    // --- Parameters specifications for Scene Export rollup ---
+
+    ParamIdParallelMeshConversion, L"parallel_mesh_conversion", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SINGLECHEKBOX, IDC_CHECK_PARALLEL_MESH_CONVERSION,
+        p_default, TRUE,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdWeldVertexAttributes, L"weld_vertex_attributes", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SINGLECHEKBOX, IDC_CHECK_WELD_VERTEX_ATTRIBUTES,
+        p_default, TRUE,
+        p_enable_ctrls, 1, ParamIdWeldTolerance,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdWeldTolerance, L"weld_tolerance", TYPE_FLOAT, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SPINNER, EDITTYPE_FLOAT, IDC_TEXT_WELD_TOLERANCE, IDC_SPINNER_WELD_TOLERANCE, SPIN_AUTOSCALE,
+        p_default, 1.0e-5f,
+        p_range, 0.0f, 1.0f,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdCacheGeometry, L"cache_geometry", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SINGLECHEKBOX, IDC_CHECK_CACHE_GEOMETRY,
+        p_default, FALSE,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdOptimizeMeshes, L"optimize_meshes", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SINGLECHEKBOX, IDC_CHECK_OPTIMIZE_MESHES,
+        p_default, FALSE,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdAutoInstancing, L"auto_instancing", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SINGLECHEKBOX, IDC_CHECK_AUTO_INSTANCING,
+        p_default, TRUE,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdAutoAssemblyInstancing, L"auto_assembly_instancing", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SINGLECHEKBOX, IDC_CHECK_AUTO_ASSEMBLY_INSTANCING,
+        p_default, TRUE,
+        p_enable_ctrls, 1, ParamIdAssemblyInstThreshold,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdAssemblyInstThreshold, L"assembly_instancing_threshold", TYPE_INT, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SPINNER, EDITTYPE_INT, IDC_TEXT_ASSEMBLY_INST_THRESHOLD, IDC_SPINNER_ASSEMBLY_INST_THRESHOLD, SPIN_AUTOSCALE,
+        p_default, 1000000,
+        p_range, 1, 1000000000,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdSplineCurves, L"spline_curves", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SINGLECHEKBOX, IDC_CHECK_SPLINE_CURVES,
+        p_default, FALSE,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdMotionBlur, L"motion_blur", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SINGLECHEKBOX, IDC_CHECK_MOTION_BLUR,
+        p_default, FALSE,
+        p_enable_ctrls, 3, ParamIdMotionSamples, ParamIdShutterDuration, ParamIdDeformationBlur,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdMotionSamples, L"motion_samples", TYPE_INT, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SPINNER, EDITTYPE_INT, IDC_TEXT_MOTION_SAMPLES, IDC_SPINNER_MOTION_SAMPLES, SPIN_AUTOSCALE,
+        p_default, 2,
+        p_range, 2, 32,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdShutterDuration, L"shutter_duration", TYPE_FLOAT, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SPINNER, EDITTYPE_FLOAT, IDC_TEXT_SHUTTER_DURATION, IDC_SPINNER_SHUTTER_DURATION, SPIN_AUTOSCALE,
+        p_default, 0.5f,
+        p_range, 0.0f, 2.0f,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdDeformationBlur, L"deformation_blur", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SINGLECHEKBOX, IDC_CHECK_DEFORMATION_BLUR,
+        p_default, FALSE,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdCacheMaterials, L"cache_materials", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSceneExport, TYPE_SINGLECHEKBOX, IDC_CHECK_CACHE_MATERIALS,
+        p_default, FALSE,
+        p_accessor, &g_pblock_accessor,
+    p_end,
     
     p_end
 );
@@ -1008,6 +1261,39 @@ namespace
         const TimeValue m_time;
     };
 
+    // Discard the materials pending in a material cache unless they were retained, so that
+    // the cache never refers to the assemblies of a project that failed to build or render.
+    class PendingMaterialsGuard
+      : public asf::NonCopyable
+    {
+      public:
+        explicit PendingMaterialsGuard(MaterialCache* material_cache)
+          : m_material_cache(material_cache)
+        {
+            if (m_material_cache != nullptr)
+                m_material_cache->discard();
+        }
+
+        ~PendingMaterialsGuard()
+        {
+            if (m_material_cache != nullptr)
+                m_material_cache->discard();
+        }
+
+        // Take the entities of the pending materials out of the project.
+        void retain()
+        {
+            if (m_material_cache != nullptr)
+            {
+                m_material_cache->retain();
+                m_material_cache = nullptr;
+            }
+        }
+
+      private:
+        MaterialCache* m_material_cache;
+    };
+
     void render_begin(
         std::vector<INode*>&    nodes,
         const TimeValue         time)
@@ -1112,11 +1398,34 @@ int AppleseedRenderer::Render(
     if (progress_cb)
         progress_cb->SetTitle(L"Collecting Entities...");
     m_entities.clear();
-    MaxSceneEntityCollector collector(m_entities);
+    MaxSceneEntityCollector collector(m_entities, time);
     collector.collect(m_scene);
 
     // Call RenderBegin() on all object instances.
-    render_begin(m_entities.m_objects, m_time);
+    render_begin(m_entities.m_object_candidates, m_time);
+
+    // Evaluate object instances once, now that they are in render mode.
+    collector.evaluate_objects();
+
+    // Keep converted geometry between renders if requested. Material previews don't use it.
+    if (!m_settings.m_cache_geometry)
+        m_geometry_cache.reset();
+    else if (!m_geometry_cache)
+        m_geometry_cache.reset(new GeometryCache());
+    GeometryCache* geometry_cache =
+        m_rend_params.inMtlEdit ? nullptr : m_geometry_cache.get();
+
+    // Likewise for the entities built by material plugins.
+    if (!m_settings.m_cache_materials)
+        m_material_cache.reset();
+    else if (!m_material_cache)
+        m_material_cache.reset(new MaterialCache());
+    MaterialCache* material_cache =
+        m_rend_params.inMtlEdit ? nullptr : m_material_cache.get();
+
+    // Declared before the project so that pending materials are discarded after it is destroyed
+    // if building, writing or rendering it throws.
+    PendingMaterialsGuard pending_materials(material_cache);
 
     // Build the project.
     if (progress_cb)
@@ -1132,6 +1441,8 @@ int AppleseedRenderer::Render(
             renderer_settings,
             bitmap,
             time,
+            geometry_cache,
+            material_cache,
             progress_cb));
 
     if (m_rend_params.inMtlEdit)
@@ -1154,9 +1465,10 @@ int AppleseedRenderer::Render(
             {
                 if (progress_cb)
                     progress_cb->SetTitle(L"Writing Project To Disk...");
-                asr::ProjectFileWriter::write(
+                write_project(
                     project.ref(),
-                    wide_to_utf8(m_settings.m_project_file_path).c_str());
+                    wide_to_utf8(m_settings.m_project_file_path).c_str(),
+                    m_settings.m_binary_mesh_files);
             }
         }
 
@@ -1198,6 +1510,9 @@ int AppleseedRenderer::Render(
         }
     }
 
+    // Take the entities of cached materials out of the project before it is destroyed.
+    pending_materials.retain();
+
     if (progress_cb)
         progress_cb->SetTitle(L"Done.");
 
@@ -1212,7 +1527,7 @@ void AppleseedRenderer::Close(
     RendProgressCallback*   progress_cb)
 {
     // Call RenderEnd() on all object instances.
-    render_end(m_entities.m_objects, m_time);
+    render_end(m_entities.m_object_candidates, m_time);
 
     clear();
 
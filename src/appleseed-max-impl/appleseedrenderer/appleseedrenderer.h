@@ -29,6 +29,8 @@
 #pragma once
 
 // appleseed-max headers.
+#include "appleseedrenderer/geometrycache.h"
+#include "appleseedrenderer/materialcache.h"
 #include "appleseedrenderer/maxsceneentities.h"
 #include "appleseedrenderer/renderersettings.h"
 
@@ -43,6 +45,7 @@
 #undef base_type
 
 // Standard headers.
+#include <memory>
 #include <vector>
 
 // Windows headers.
@@ -176,16 +179,18 @@ class AppleseedRenderer
   private:
     friend AppleseedRendererPBlockAccessor;
 
-    AppleseedInteractiveRender* m_interactive_renderer;
-    RendererSettings            m_settings;
-    INode*                      m_scene;
-    INode*                      m_view_node;
-    ViewParams                  m_view_params;
-    RendParams                  m_rend_params;
-    std::vector<DefaultLight>   m_default_lights;
-    TimeValue                   m_time;
-    MaxSceneEntities            m_entities;
-    IParamBlock2*               m_param_block;
+    AppleseedInteractiveRender*        m_interactive_renderer;
+    RendererSettings                   m_settings;
+    INode*                             m_scene;
+    INode*                             m_view_node;
+    ViewParams                         m_view_params;
+    RendParams                         m_rend_params;
+    std::vector<DefaultLight>          m_default_lights;
+    TimeValue                          m_time;
+    MaxSceneEntities                   m_entities;
+    IParamBlock2*                      m_param_block;
+    std::unique_ptr<GeometryCache>     m_geometry_cache;
+    std::unique_ptr<MaterialCache>     m_material_cache;
 
     void clear();
 };
@@ -343,6 +343,7 @@ namespace
             m_static_project_filepath = GetDlgItem(hwnd, IDC_STATIC_PROJECT_FILEPATH);
             m_button_browse = GetICustButton(GetDlgItem(hwnd, IDC_BUTTON_BROWSE));
             m_text_project_filepath = GetICustEdit(GetDlgItem(hwnd, IDC_TEXT_PROJECT_FILEPATH));
+            m_check_binary_mesh_files = GetDlgItem(hwnd, IDC_CHECK_BINARY_MESH_FILES);
         }
 
         void enable_disable_controls()
@@ -365,6 +366,7 @@ namespace
 
             EnableWindow(m_static_project_filepath, save_project && !use_max_procedural_maps ? TRUE : FALSE);
             m_button_browse->Enable(save_project && !use_max_procedural_maps);
+            EnableWindow(m_check_binary_mesh_files, save_project && !use_max_procedural_maps ? TRUE : FALSE);
         }
 
       private:
@@ -374,6 +376,7 @@ namespace
         HWND            m_static_project_filepath;
         ICustButton*    m_button_browse;
         ICustEdit*      m_text_project_filepath;
+        HWND            m_check_binary_mesh_files;
         IParamBlock2*   m_pblock;
     };
 
@@ -439,6 +442,7 @@ struct AppleseedRendererParamDlg::Impl
     IParamMap2*                 m_pmap_image_sampling;
     IParamMap2*                 m_pmap_lighting;
     IParamMap2*                 m_pmap_system;
+    IParamMap2*                 m_pmap_scene_export;
 
     Impl(
         IRendParams*        rend_params,
@@ -448,6 +452,7 @@ struct AppleseedRendererParamDlg::Impl
       , m_pmap_image_sampling(nullptr)
       , m_pmap_lighting(nullptr)
       , m_pmap_system(nullptr)
+      , m_pmap_scene_export(nullptr)
     {
         if (!in_progress)
         {
@@ -491,10 +496,22 @@ struct AppleseedRendererParamDlg::Impl
             L"System",
             0,
             new SystemParamMapDlgProc(renderer));
+
+        m_pmap_scene_export = CreateRParamMap2(
+            4,
+            renderer->GetParamBlock(0),
+            rend_params,
+            g_module,
+            MAKEINTRESOURCE(IDD_FORMVIEW_RENDERERPARAMS_SCENEEXPORT),
+            L"Scene Export",
+            0);
     }
 
     ~Impl()
     {
+        if (m_pmap_scene_export != nullptr)
+            DestroyRParamMap2(m_pmap_scene_export);
+
         if (m_pmap_system != nullptr)
             DestroyRParamMap2(m_pmap_system);
 
@@ -61,6 +61,7 @@ const USHORT ChunkSettingsOutput                        = 0x1300;
 const USHORT ChunkSettingsOutputMode                    = 0x1310;
 const USHORT ChunkSettingsOutputProjectFilePath         = 0x1320;
 const USHORT ChunkSettingsOutputScaleMultiplier         = 0x1330;
+const USHORT ChunkSettingsOutputBinaryMeshFiles         = 0x1340;
 
 const USHORT ChunkSettingsSystem                        = 0x1400;
 const USHORT ChunkSettingsSystemRenderingThreads        = 0x1410;
@@ -68,3 +69,19 @@ const USHORT ChunkSettingsSystemLowPriorityMode         = 0x1420;
 const USHORT ChunkSettingsSystemUseMaxProceduralMaps    = 0x1430;
 const USHORT ChunkSettingsSystemEnableRenderStamp       = 0x1440;
 const USHORT ChunkSettingsSystemRenderStampString       = 0x1450;
+
+const USHORT ChunkSettingsSceneExport                   = 0x1500;
+const USHORT ChunkSettingsSceneExportParallelMeshConv   = 0x1510;
+const USHORT ChunkSettingsSceneExportWeldVertexAttribs  = 0x1520;
+const USHORT ChunkSettingsSceneExportWeldTolerance      = 0x1530;
+const USHORT ChunkSettingsSceneExportCacheGeometry      = 0x1540;
+const USHORT ChunkSettingsSceneExportOptimizeMeshes     = 0x1550;
+const USHORT ChunkSettingsSceneExportAutoInstancing     = 0x1560;
+const USHORT ChunkSettingsSceneExportAutoAssemblyInst   = 0x1570;
+const USHORT ChunkSettingsSceneExportAsmInstThreshold   = 0x1580;
+const USHORT ChunkSettingsSceneExportSplineCurves       = 0x1590;
+const USHORT ChunkSettingsSceneExportMotionBlur         = 0x15A0;
+const USHORT ChunkSettingsSceneExportMotionSamples      = 0x15B0;
+const USHORT ChunkSettingsSceneExportShutterDuration    = 0x15C0;
+const USHORT ChunkSettingsSceneExportDeformationBlur    = 0x15D0;
+const USHORT ChunkSettingsSceneExportCacheMaterials     = 0x15E0;
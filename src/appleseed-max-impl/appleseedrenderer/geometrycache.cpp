@@ -0,0 +1,224 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "geometrycache.h"
+
+// 3ds Max headers.
+#include <inode.h>
+#include <ISceneEventManager.h>
+#include <notify.h>
+#include <object.h>
+
+// Standard headers.
+#include <utility>
+
+namespace
+{
+    class GeometryChangeCallback
+      : public INodeEventCallback
+    {
+      public:
+        explicit GeometryChangeCallback(GeometryCache& cache)
+          : m_cache(cache)
+        {
+            m_callback_key = GetISceneEventManager()->RegisterCallback(this, false, 0, false);
+        }
+
+        ~GeometryChangeCallback() override
+        {
+            GetISceneEventManager()->UnRegisterCallback(m_callback_key);
+        }
+
+        void Deleted(NodeKeyTab& nodes) override
+        {
+            // Deleted objects may be freed and their addresses reused by new objects.
+            m_cache.clear();
+        }
+
+        void ModelStructured(NodeKeyTab& nodes) override
+        {
+            invalidate(nodes);
+        }
+
+        void GeometryChanged(NodeKeyTab& nodes) override
+        {
+            invalidate(nodes);
+        }
+
+        void TopologyChanged(NodeKeyTab& nodes) override
+        {
+            invalidate(nodes);
+        }
+
+        void MappingChanged(NodeKeyTab& nodes) override
+        {
+            invalidate(nodes);
+        }
+
+        void ExtentionChannelChanged(NodeKeyTab& nodes) override
+        {
+            invalidate(nodes);
+        }
+
+        void ModelOtherEvent(NodeKeyTab& nodes) override
+        {
+            invalidate(nodes);
+        }
+
+      private:
+        GeometryCache&                      m_cache;
+        SceneEventNamespace::CallbackKey    m_callback_key;
+
+        void invalidate(NodeKeyTab& nodes)
+        {
+            for (int i = 0, e = nodes.Count(); i < e; ++i)
+            {
+                INode* node = NodeEventNamespace::GetNodeByKey(nodes[i]);
+                if (node != nullptr)
+                    m_cache.invalidate(node->GetObjectRef());
+            }
+        }
+    };
+
+    const int ResetNotifications[] =
+    {
+        NOTIFY_SYSTEM_PRE_RESET,
+        NOTIFY_SYSTEM_PRE_NEW,
+        NOTIFY_FILE_PRE_OPEN
+    };
+}
+
+
+//
+// GeometryCache class implementation.
+//
+
+GeometryCache::GeometryCache()
+{
+    m_node_callback.reset(new GeometryChangeCallback(*this));
+
+    for (const auto code : ResetNotifications)
+        RegisterNotification(&GeometryCache::on_scene_reset, this, code);
+}
+
+GeometryCache::~GeometryCache()
+{
+    for (const auto code : ResetNotifications)
+        UnRegisterNotification(&GeometryCache::on_scene_reset, this, code);
+}
+
+bool GeometryCache::fetch(
+    INode*                          node,
+    Object*                         object,
+    const Interval&                 interval,
+    const MeshConversionParams&     params,
+    MeshConversionJobs&             jobs) const
+{
+    const auto it = m_entries.find(object);
+    if (it == m_entries.end())
+        return false;
+
+    // The object may have been replaced by another object allocated at the same address,
+    // for instance when the modifier stack is collapsed.
+    const Entry& entry = *it->second;
+    if (entry.m_node_handle != node->GetHandle() || entry.m_class_id != object->ClassID())
+        return false;
+
+    if (!entry.m_validity.InInterval(interval) || entry.m_params != params)
+        return false;
+
+    for (size_t i = 0, e = entry.m_snapshots.size(); i < e; ++i)
+    {
+        std::unique_ptr<MeshConversionJob> job(new MeshConversionJob());
+        job->m_snapshot = *entry.m_snapshots[i];
+        job->m_content_hash = entry.m_content_hashes[i];
+        job->m_params = params;
+        job->m_snapshot_processed = true;
+        jobs.push_back(std::move(job));
+    }
+
+    return true;
+}
+
+void GeometryCache::insert(
+    INode*                          node,
+    Object*                         object,
+    const Interval&                 validity,
+    const MeshConversionParams&     params,
+    MeshConversionJobs&             jobs)
+{
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->m_node_handle = node->GetHandle();
+    entry->m_class_id = object->ClassID();
+    entry->m_validity = validity;
+    entry->m_params = params;
+
+    for (auto& job : jobs)
+    {
+        std::unique_ptr<MeshSnapshot> snapshot(new MeshSnapshot());
+        snapshot->swap(job->m_snapshot);
+        entry->m_snapshots.push_back(std::move(snapshot));
+        entry->m_content_hashes.push_back(job->m_content_hash);
+    }
+
+    m_entries[object] = std::move(entry);
+}
+
+void GeometryCache::invalidate(Object* object)
+{
+    m_entries.erase(object);
+}
+
+void GeometryCache::clear()
+{
+    m_entries.clear();
+}
+
+size_t GeometryCache::get_object_count() const
+{
+    return m_entries.size();
+}
+
+size_t GeometryCache::get_triangle_count() const
+{
+    size_t triangle_count = 0;
+
+    for (const auto& entry : m_entries)
+    {
+        for (const auto& snapshot : entry.second->m_snapshots)
+            triangle_count += snapshot->m_triangles.size();
+    }
+
+    return triangle_count;
+}
+
+void GeometryCache::on_scene_reset(void* param, NotifyInfo* info)
+{
+    static_cast<GeometryCache*>(param)->clear();
+}
@@ -0,0 +1,114 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed-max headers.
+#include "appleseedrenderer/meshconversion.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/platform/windows.h"    // include before 3ds Max headers
+
+// 3ds Max headers.
+#include <interval.h>
+#include <maxtypes.h>
+
+// Standard headers.
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Forward declarations.
+class INode;
+class INodeEventCallback;
+class Object;
+struct NotifyInfo;
+
+//
+// Keeps mesh snapshots between renders so that unchanged objects are not
+// re-evaluated and re-converted. Entries are keyed by the object referenced
+// by scene nodes, and are dropped when 3ds Max reports a change to the
+// geometry, topology or mapping of a node referencing them. Since a freed
+// object's address may be reused, entries also record the node they were
+// taken from and the class of the object, and are only served if both match.
+//
+
+class GeometryCache
+  : public foundation::NonCopyable
+{
+  public:
+    GeometryCache();
+    ~GeometryCache();
+
+    // Return true if the cache holds snapshots of a given object, taken from a given node, that
+    // are valid over a given interval and were produced with given conversion parameters. If so,
+    // append a conversion job per cached snapshot to `jobs`.
+    bool fetch(
+        INode*                          node,
+        Object*                         object,
+        const Interval&                 interval,
+        const MeshConversionParams&     params,
+        MeshConversionJobs&             jobs) const;
+
+    // Move the snapshots of executed conversion jobs into the cache.
+    void insert(
+        INode*                          node,
+        Object*                         object,
+        const Interval&                 validity,
+        const MeshConversionParams&     params,
+        MeshConversionJobs&             jobs);
+
+    // Remove the entry of a given object, if any.
+    void invalidate(Object* object);
+
+    // Remove all entries.
+    void clear();
+
+    size_t get_object_count() const;
+    size_t get_triangle_count() const;
+
+  private:
+    struct Entry
+    {
+        ULONG                                       m_node_handle;
+        Class_ID                                    m_class_id;
+        Interval                                    m_validity;
+        MeshConversionParams                        m_params;
+        std::vector<std::unique_ptr<MeshSnapshot>>  m_snapshots;
+        std::vector<foundation::uint64>             m_content_hashes;
+    };
+
+    typedef std::map<Object*, std::unique_ptr<Entry>> EntryMap;
+
+    EntryMap                            m_entries;
+    std::unique_ptr<INodeEventCallback> m_node_callback;
+
+    static void on_scene_reset(void* param, NotifyInfo* info);
+};
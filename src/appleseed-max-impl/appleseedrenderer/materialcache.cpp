@@ -0,0 +1,696 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "materialcache.h"
+
+// appleseed-max headers.
+#include "utilities.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/bsdf.h"
+#include "renderer/api/bssrdf.h"
+#include "renderer/api/color.h"
+#include "renderer/api/edf.h"
+#include "renderer/api/material.h"
+#include "renderer/api/scene.h"
+#include "renderer/api/shadergroup.h"
+#include "renderer/api/surfaceshader.h"
+#include "renderer/api/texture.h"
+
+// appleseed.foundation headers.
+#include "foundation/utility/casts.h"
+#include "foundation/utility/containers/dictionary.h"
+
+// 3ds Max headers.
+#include <imtl.h>
+#include <iparamb.h>
+#include <iparamb2.h>
+#include <notify.h>
+#include <pbbitmap.h>
+#include <stdmat.h>
+
+// Standard headers.
+#include <functional>
+#include <set>
+#include <utility>
+
+namespace asf = foundation;
+namespace asr = renderer;
+
+namespace
+{
+    //
+    // Content hashing.
+    //
+
+    class ContentHasher
+    {
+      public:
+        ContentHasher()
+          : m_hash(0xCBF29CE484222325ULL)
+        {
+        }
+
+        void append(const asf::uint64 value)
+        {
+            m_hash ^= value;
+            m_hash *= 0x9E3779B97F4A7C15ULL;
+            m_hash ^= m_hash >> 32;
+        }
+
+        void append(const float value)
+        {
+            append(static_cast<asf::uint64>(asf::binary_cast<asf::uint32>(value)));
+        }
+
+        void append(const Point3& p)
+        {
+            append(p.x);
+            append(p.y);
+            append(p.z);
+        }
+
+        void append(const MCHAR* s)
+        {
+            append(static_cast<asf::uint64>(std::hash<std::wstring>()(s != nullptr ? s : L"")));
+        }
+
+        asf::uint64 get_hash() const
+        {
+            return m_hash;
+        }
+
+      private:
+        asf::uint64 m_hash;
+    };
+
+    typedef std::set<ReferenceTarget*> VisitedTargets;
+
+    void append_reference_target(
+        ContentHasher&      hasher,
+        ReferenceTarget*    target,
+        const TimeValue     time,
+        VisitedTargets&     visited);
+
+    void append_param_block_value(
+        ContentHasher&      hasher,
+        IParamBlock2*       pblock,
+        const ParamID       id,
+        const int           type,
+        const int           index,
+        const TimeValue     time,
+        VisitedTargets&     visited)
+    {
+        switch (type)
+        {
+          case TYPE_FLOAT:
+          case TYPE_ANGLE:
+          case TYPE_PCNT_FRAC:
+          case TYPE_WORLD:
+          case TYPE_COLOR_CHANNEL:
+            hasher.append(pblock->GetFloat(id, time, index));
+            break;
+
+          case TYPE_INT:
+          case TYPE_BOOL:
+          case TYPE_TIMEVALUE:
+          case TYPE_RADIOBTN_INDEX:
+          case TYPE_INDEX:
+            hasher.append(static_cast<asf::uint64>(pblock->GetInt(id, time, index)));
+            break;
+
+          case TYPE_RGBA:
+          case TYPE_POINT3:
+          case TYPE_HSV:
+            hasher.append(pblock->GetPoint3(id, time, index));
+            break;
+
+          case TYPE_FRGBA:
+          case TYPE_POINT4:
+            {
+                const Point4 p = pblock->GetPoint4(id, time, index);
+                hasher.append(p.x);
+                hasher.append(p.y);
+                hasher.append(p.z);
+                hasher.append(p.w);
+            }
+            break;
+
+          case TYPE_STRING:
+          case TYPE_FILENAME:
+            hasher.append(pblock->GetStr(id, time, index));
+            break;
+
+          case TYPE_BITMAP:
+            {
+                PBBitmap* bitmap = pblock->GetBitmap(id, time, index);
+                hasher.append(bitmap != nullptr ? bitmap->bi.Name() : nullptr);
+            }
+            break;
+
+          case TYPE_TEXMAP:
+            append_reference_target(hasher, pblock->GetTexmap(id, time, index), time, visited);
+            break;
+
+          case TYPE_MTL:
+            append_reference_target(hasher, pblock->GetMtl(id, time, index), time, visited);
+            break;
+
+          case TYPE_REFTARG:
+            append_reference_target(hasher, pblock->GetReferenceTarget(id, time, index), time, visited);
+            break;
+
+          // Other types (nodes, matrices, etc.) don't affect materials.
+        }
+    }
+
+    void append_param_block(
+        ContentHasher&      hasher,
+        IParamBlock2*       pblock,
+        const TimeValue     time,
+        VisitedTargets&     visited)
+    {
+        for (int i = 0, e = pblock->NumParams(); i < e; ++i)
+        {
+            const ParamID id = pblock->IndextoID(i);
+            const int type = pblock->GetParameterType(id);
+            const int count = (type & TYPE_TAB) != 0 ? pblock->Count(id) : 1;
+
+            hasher.append(static_cast<asf::uint64>(id));
+            hasher.append(static_cast<asf::uint64>(count));
+
+            for (int j = 0; j < count; ++j)
+                append_param_block_value(hasher, pblock, id, type & ~TYPE_TAB, j, time, visited);
+        }
+    }
+
+    // Parameter blocks of older plugins such as the standard UV generator.
+    void append_legacy_param_block(
+        ContentHasher&      hasher,
+        IParamBlock*        pblock,
+        const TimeValue     time)
+    {
+        for (int i = 0, e = pblock->NumParams(); i < e; ++i)
+        {
+            Interval validity = FOREVER;
+
+            switch (pblock->GetParameterType(i))
+            {
+              case TYPE_FLOAT:
+                {
+                    float value;
+                    pblock->GetValue(i, time, value, validity);
+                    hasher.append(value);
+                }
+                break;
+
+              case TYPE_INT:
+              case TYPE_BOOL:
+                {
+                    int value;
+                    pblock->GetValue(i, time, value, validity);
+                    hasher.append(static_cast<asf::uint64>(value));
+                }
+                break;
+
+              case TYPE_RGBA:
+              case TYPE_POINT3:
+                {
+                    Point3 value;
+                    pblock->GetValue(i, time, value, validity);
+                    hasher.append(value);
+                }
+                break;
+            }
+        }
+    }
+
+    bool is_shading_class(const SClass_ID super_class_id)
+    {
+        return
+            super_class_id == MATERIAL_CLASS_ID ||
+            super_class_id == TEXMAP_CLASS_ID ||
+            super_class_id == UVGEN_CLASS_ID ||
+            super_class_id == XYZGEN_CLASS_ID ||
+            super_class_id == TEXOUTPUT_CLASS_ID;
+    }
+
+    void append_reference_target(
+        ContentHasher&      hasher,
+        ReferenceTarget*    target,
+        const TimeValue     time,
+        VisitedTargets&     visited)
+    {
+        if (target == nullptr)
+        {
+            hasher.append(static_cast<asf::uint64>(0));
+            return;
+        }
+
+        // Shading trees may share texture maps.
+        if (!visited.insert(target).second)
+        {
+            hasher.append(static_cast<asf::uint64>(1));
+            return;
+        }
+
+        const Class_ID class_id = target->ClassID();
+        hasher.append(static_cast<asf::uint64>(class_id.PartA()));
+        hasher.append(static_cast<asf::uint64>(class_id.PartB()));
+
+        const SClass_ID super_class_id = target->SuperClassID();
+        if (super_class_id == MATERIAL_CLASS_ID || super_class_id == TEXMAP_CLASS_ID)
+        {
+            // Entity names are derived from material and texture map names.
+            hasher.append(static_cast<MtlBase*>(target)->GetName().data());
+
+            if (super_class_id == TEXMAP_CLASS_ID && is_bitmap_texture(static_cast<Texmap*>(target)))
+                hasher.append(static_cast<BitmapTex*>(target)->GetMap().GetFullFilePath().data());
+        }
+
+        // Animation controllers are not visited: parameter blocks are evaluated at `time`.
+        for (int i = 0, e = target->NumRefs(); i < e; ++i)
+        {
+            ReferenceTarget* ref = target->GetReference(i);
+            if (ref == nullptr)
+                continue;
+
+            const SClass_ID ref_super_class_id = ref->SuperClassID();
+            if (ref_super_class_id == PARAMETER_BLOCK2_CLASS_ID)
+                append_param_block(hasher, static_cast<IParamBlock2*>(ref), time, visited);
+            else if (ref_super_class_id == PARAMETER_BLOCK_CLASS_ID)
+                append_legacy_param_block(hasher, static_cast<IParamBlock*>(ref), time);
+            else if (is_shading_class(ref_super_class_id))
+                append_reference_target(hasher, ref, time, visited);
+        }
+    }
+
+
+    //
+    // Entity containers.
+    //
+
+    // Index of each container in which material plugins insert entities.
+    enum Container
+    {
+        Colors,
+        Textures,
+        TextureInstances,
+        ShaderGroups,
+        BSDFs,
+        BSSRDFs,
+        EDFs,
+        SurfaceShaders,
+        Materials
+    };
+
+    // Textures and texture instances are named after texture maps and shared by materials.
+    bool is_shared_container(const size_t container)
+    {
+        return container == Textures || container == TextureInstances;
+    }
+
+    template <typename Function>
+    void for_each_container(asr::Assembly& assembly, Function& f)
+    {
+        f(assembly.colors(), Colors);
+        f(assembly.textures(), Textures);
+        f(assembly.texture_instances(), TextureInstances);
+        f(assembly.shader_groups(), ShaderGroups);
+        f(assembly.bsdfs(), BSDFs);
+        f(assembly.bssrdfs(), BSSRDFs);
+        f(assembly.edfs(), EDFs);
+        f(assembly.surface_shaders(), SurfaceShaders);
+        f(assembly.materials(), Materials);
+    }
+
+    template <typename Function>
+    void for_each_container(asr::Assembly& source, asr::Assembly& dest, Function& f)
+    {
+        f(source.colors(), dest.colors(), Colors);
+        f(source.textures(), dest.textures(), Textures);
+        f(source.texture_instances(), dest.texture_instances(), TextureInstances);
+        f(source.shader_groups(), dest.shader_groups(), ShaderGroups);
+        f(source.bsdfs(), dest.bsdfs(), BSDFs);
+        f(source.bssrdfs(), dest.bssrdfs(), BSSRDFs);
+        f(source.edfs(), dest.edfs(), EDFs);
+        f(source.surface_shaders(), dest.surface_shaders(), SurfaceShaders);
+        f(source.materials(), dest.materials(), Materials);
+    }
+
+    struct GetContainerSizes
+    {
+        MaterialCache::Mark& m_mark;
+
+        explicit GetContainerSizes(MaterialCache::Mark& mark)
+          : m_mark(mark)
+        {
+        }
+
+        template <typename EntityContainer>
+        void operator()(EntityContainer& entities, const size_t container)
+        {
+            m_mark.m_sizes[container] = entities.size();
+        }
+    };
+
+    struct GetNamesSinceMark
+    {
+        const MaterialCache::Mark&  m_mark;
+        std::vector<std::string>*   m_names;
+
+        GetNamesSinceMark(const MaterialCache::Mark& mark, std::vector<std::string>* names)
+          : m_mark(mark)
+          , m_names(names)
+        {
+        }
+
+        template <typename EntityContainer>
+        void operator()(EntityContainer& entities, const size_t container)
+        {
+            for (size_t i = m_mark.m_sizes[container], e = entities.size(); i < e; ++i)
+                m_names[container].push_back(entities.get_by_index(i)->get_name());
+        }
+    };
+
+    // Find the names of the texture instances referenced by the parameters of given entities.
+    struct GetTextureInstanceRefs
+    {
+        asr::TextureInstanceContainer&  m_texture_instances;
+        const std::vector<std::string>* m_names;
+        std::set<std::string>           m_refs;
+
+        GetTextureInstanceRefs(
+            asr::TextureInstanceContainer&  texture_instances,
+            const std::vector<std::string>* names)
+          : m_texture_instances(texture_instances)
+          , m_names(names)
+        {
+        }
+
+        template <typename EntityContainer>
+        void operator()(EntityContainer& entities, const size_t container)
+        {
+            for (const auto& name : m_names[container])
+            {
+                const auto* entity = entities.get_by_name(name.c_str());
+                if (entity != nullptr)
+                    collect(entity->get_parameters());
+            }
+        }
+
+        void collect(const asf::Dictionary& params)
+        {
+            for (auto i = params.strings().begin(), e = params.strings().end(); i != e; ++i)
+            {
+                if (m_texture_instances.get_by_name(i.value()) != nullptr)
+                    m_refs.insert(i.value());
+            }
+
+            for (auto i = params.dictionaries().begin(), e = params.dictionaries().end(); i != e; ++i)
+                collect(i.value());
+        }
+    };
+
+    // Check whether entities would clash with entities of another assembly.
+    struct HasNameClash
+    {
+        bool m_clash;
+
+        HasNameClash()
+          : m_clash(false)
+        {
+        }
+
+        template <typename EntityContainer>
+        void operator()(EntityContainer& source, EntityContainer& dest, const size_t container)
+        {
+            if (is_shared_container(container))
+                return;
+
+            for (size_t i = 0, e = source.size(); i < e; ++i)
+            {
+                if (dest.get_by_name(source.get_by_index(i)->get_name()) != nullptr)
+                    m_clash = true;
+            }
+        }
+    };
+
+    // Move all entities of an assembly to another, skipping shared entities that already exist.
+    struct MoveAllEntities
+    {
+        std::vector<std::string>* m_names;
+
+        explicit MoveAllEntities(std::vector<std::string>* names)
+          : m_names(names)
+        {
+        }
+
+        template <typename EntityContainer>
+        void operator()(EntityContainer& source, EntityContainer& dest, const size_t container)
+        {
+            while (source.size() > 0)
+            {
+                auto* entity = source.get_by_index(source.size() - 1);
+                const std::string name = entity->get_name();
+                auto entity_ptr = source.remove(entity);
+
+                if (dest.get_by_name(name.c_str()) == nullptr)
+                {
+                    dest.insert(entity_ptr);
+                    m_names[container].push_back(name);
+                }
+            }
+        }
+    };
+
+    struct MoveNamedEntities
+    {
+        const std::vector<std::string>* m_names;
+
+        explicit MoveNamedEntities(const std::vector<std::string>* names)
+          : m_names(names)
+        {
+        }
+
+        template <typename EntityContainer>
+        void operator()(EntityContainer& source, EntityContainer& dest, const size_t container)
+        {
+            for (const auto& name : m_names[container])
+            {
+                auto* entity = source.get_by_name(name.c_str());
+                if (entity != nullptr)
+                    dest.insert(source.remove(entity));
+            }
+        }
+    };
+
+    const int ResetNotifications[] =
+    {
+        NOTIFY_SYSTEM_PRE_RESET,
+        NOTIFY_SYSTEM_PRE_NEW,
+        NOTIFY_FILE_PRE_OPEN
+    };
+}
+
+
+//
+// MaterialCache class implementation.
+//
+
+MaterialCache::MaterialCache()
+  : m_reused_material_count(0)
+{
+    for (const auto code : ResetNotifications)
+        RegisterNotification(&MaterialCache::on_scene_reset, this, code);
+}
+
+MaterialCache::~MaterialCache()
+{
+    for (const auto code : ResetNotifications)
+        UnRegisterNotification(&MaterialCache::on_scene_reset, this, code);
+}
+
+asf::uint64 MaterialCache::compute_content_hash(
+    Mtl*                            mtl,
+    const TimeValue                 time,
+    const bool                      use_max_procedural_maps)
+{
+    ContentHasher hasher;
+    hasher.append(static_cast<asf::uint64>(use_max_procedural_maps));
+
+    VisitedTargets visited;
+    append_reference_target(hasher, mtl, time, visited);
+
+    return hasher.get_hash();
+}
+
+MaterialCache::Mark MaterialCache::mark(asr::Assembly& assembly)
+{
+    Mark mark;
+    GetContainerSizes get_sizes(mark);
+    for_each_container(assembly, get_sizes);
+    return mark;
+}
+
+bool MaterialCache::fetch(
+    Mtl*                            mtl,
+    const asf::uint64               content_hash,
+    asr::Assembly&                  assembly,
+    std::string&                    material_name)
+{
+    const auto it = m_entries.find(mtl);
+    if (it == m_entries.end())
+        return false;
+
+    // Whether it can be reused or not, the entry is consumed.
+    std::unique_ptr<Entry> entry(std::move(it->second));
+    m_entries.erase(it);
+
+    if (entry->m_content_hash != content_hash)
+        return false;
+
+    // Texture instances shared with other materials must have been inserted already.
+    for (const auto& ref : entry->m_texture_instance_refs)
+    {
+        if (assembly.texture_instances().get_by_name(ref.c_str()) == nullptr &&
+            entry->m_entities->texture_instances().get_by_name(ref.c_str()) == nullptr)
+            return false;
+    }
+
+    HasNameClash has_name_clash;
+    for_each_container(entry->m_entities.ref(), assembly, has_name_clash);
+    if (has_name_clash.m_clash)
+        return false;
+
+    PendingMaterial pending;
+    pending.m_mtl = mtl;
+    pending.m_content_hash = content_hash;
+    pending.m_material_name = entry->m_material_name;
+    pending.m_assembly = &assembly;
+
+    MoveAllEntities move_entities(pending.m_names);
+    for_each_container(entry->m_entities.ref(), assembly, move_entities);
+
+    m_pending.push_back(pending);
+    ++m_reused_material_count;
+
+    material_name = entry->m_material_name;
+
+    return true;
+}
+
+void MaterialCache::insert(
+    Mtl*                            mtl,
+    const asf::uint64               content_hash,
+    const std::string&              material_name,
+    asr::Assembly&                  assembly,
+    const Mark&                     mark)
+{
+    PendingMaterial pending;
+    pending.m_mtl = mtl;
+    pending.m_content_hash = content_hash;
+    pending.m_material_name = material_name;
+    pending.m_assembly = &assembly;
+
+    GetNamesSinceMark get_names(mark, pending.m_names);
+    for_each_container(assembly, get_names);
+
+    m_pending.push_back(pending);
+}
+
+void MaterialCache::retain()
+{
+    // Find shared texture instances before any of them is taken out of the assemblies.
+    std::vector<std::vector<std::string>> refs(m_pending.size());
+    for (size_t i = 0, e = m_pending.size(); i < e; ++i)
+    {
+        const PendingMaterial& pending = m_pending[i];
+        GetTextureInstanceRefs get_refs(pending.m_assembly->texture_instances(), pending.m_names);
+        for_each_container(*pending.m_assembly, get_refs);
+        refs[i].assign(get_refs.m_refs.begin(), get_refs.m_refs.end());
+    }
+
+    EntryMap entries;
+
+    for (size_t i = 0, e = m_pending.size(); i < e; ++i)
+    {
+        const PendingMaterial& pending = m_pending[i];
+
+        std::unique_ptr<Entry> entry(new Entry());
+        entry->m_content_hash = pending.m_content_hash;
+        entry->m_material_name = pending.m_material_name;
+        entry->m_entities.reset(asr::AssemblyFactory().create(pending.m_material_name.c_str()).release());
+        entry->m_texture_instance_refs.swap(refs[i]);
+
+        MoveNamedEntities move_entities(pending.m_names);
+        for_each_container(*pending.m_assembly, entry->m_entities.ref(), move_entities);
+
+        // Optimized OSL shader groups belong to the shading system of the finished render.
+        for (auto& shader_group : entry->m_entities->shader_groups())
+            shader_group.release_optimized_osl_shader_group();
+
+        entries[pending.m_mtl] = std::move(entry);
+    }
+
+    m_entries.swap(entries);
+    m_pending.clear();
+    m_reused_material_count = 0;
+}
+
+void MaterialCache::discard()
+{
+    for (const auto& pending : m_pending)
+        m_entries.erase(pending.m_mtl);
+
+    m_pending.clear();
+    m_reused_material_count = 0;
+}
+
+void MaterialCache::clear()
+{
+    m_entries.clear();
+    m_pending.clear();
+    m_reused_material_count = 0;
+}
+
+size_t MaterialCache::get_material_count() const
+{
+    return m_entries.size();
+}
+
+size_t MaterialCache::get_reused_material_count() const
+{
+    return m_reused_material_count;
+}
+
+void MaterialCache::on_scene_reset(void* param, NotifyInfo* info)
+{
+    static_cast<MaterialCache*>(param)->clear();
+}
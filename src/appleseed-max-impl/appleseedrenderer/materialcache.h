@@ -0,0 +1,147 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/platform/types.h"
+#include "foundation/platform/windows.h"    // include before 3ds Max headers
+#include "foundation/utility/autoreleaseptr.h"
+
+// 3ds Max headers.
+#include <maxtypes.h>
+
+// Standard headers.
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Forward declarations.
+namespace renderer { class Assembly; }
+class Mtl;
+struct NotifyInfo;
+
+//
+// Keeps the entities built by appleseed material plugins between renders so that unchanged
+// materials are not rebuilt. Entries are keyed by material and are only reused if the content
+// hash of the material, computed from the values of its parameter blocks and of the texture
+// maps it references, did not change.
+//
+// Entities are moved into the assembly of the project being built by fetch(), and taken back
+// out of it by retain() once the project has been rendered.
+//
+
+class MaterialCache
+  : public foundation::NonCopyable
+{
+  public:
+    // Number of entity containers in which material plugins insert entities.
+    static const size_t ContainerCount = 9;
+
+    // Sizes of the entity containers of an assembly at a given point.
+    struct Mark
+    {
+        size_t m_sizes[ContainerCount];
+    };
+
+    MaterialCache();
+    ~MaterialCache();
+
+    // Compute a hash of the parameter values of a material at a given time, including the ones
+    // of the texture maps and sub-materials it references.
+    static foundation::uint64 compute_content_hash(
+        Mtl*                            mtl,
+        const TimeValue                 time,
+        const bool                      use_max_procedural_maps);
+
+    static Mark mark(renderer::Assembly& assembly);
+
+    // Return true if the cache holds the entities of a given material built with a given content
+    // hash and they could be moved into `assembly`. If so, set `material_name` to the name of
+    // the appleseed material.
+    bool fetch(
+        Mtl*                            mtl,
+        const foundation::uint64        content_hash,
+        renderer::Assembly&             assembly,
+        std::string&                    material_name);
+
+    // Record the entities inserted into `assembly` since `mark` as the ones making up a material.
+    void insert(
+        Mtl*                            mtl,
+        const foundation::uint64        content_hash,
+        const std::string&              material_name,
+        renderer::Assembly&             assembly,
+        const Mark&                     mark);
+
+    // Take the entities of the materials fetched or inserted since the last call out of their
+    // assemblies. Must be called after rendering and before the project is destroyed. Entries
+    // of materials that were not fetched or inserted since the last call are dropped.
+    void retain();
+
+    // Forget the materials fetched or inserted since the last call to retain(), for instance
+    // when building or rendering the project failed. Entries of fetched materials are dropped
+    // since their entities were moved into the project.
+    void discard();
+
+    // Remove all entries.
+    void clear();
+
+    size_t get_material_count() const;
+
+    // Return the number of materials fetched since the last call to retain().
+    size_t get_reused_material_count() const;
+
+  private:
+    struct Entry
+    {
+        foundation::uint64                                m_content_hash;
+        std::string                                       m_material_name;
+        foundation::auto_release_ptr<renderer::Assembly>  m_entities;
+        std::vector<std::string>                          m_texture_instance_refs;
+    };
+
+    struct PendingMaterial
+    {
+        Mtl*                                              m_mtl;
+        foundation::uint64                                m_content_hash;
+        std::string                                       m_material_name;
+        renderer::Assembly*                               m_assembly;
+        std::vector<std::string>                          m_names[ContainerCount];
+    };
+
+    typedef std::map<Mtl*, std::unique_ptr<Entry>> EntryMap;
+
+    EntryMap                            m_entries;
+    std::vector<PendingMaterial>        m_pending;
+    size_t                              m_reused_material_count;
+
+    static void on_scene_reset(void* param, NotifyInfo* info);
+};
@@ -34,8 +34,56 @@
 #include "foundation/utility/memory.h"
 
 // 3ds Max headers.
+#include <IParticleObjectExt.h>
 #include <object.h>
 
+// Standard headers.
+#include <algorithm>
+#include <utility>
+
+
+bool is_particle_system(Object* object)
+{
+    return
+        object->GetInterface(I_PARTICLEOBJ) != nullptr ||
+        GetParticleObjectExtInterface(object) != nullptr;
+}
+
+namespace
+{
+    // Classify a node by its base object, without evaluating its modifier stack.
+    MaxSceneEntities::NodeType classify_node(INode* node)
+    {
+        Object* object = node->GetObjectRef();
+        if (object == nullptr)
+            return MaxSceneEntities::NodeType::Other;
+
+        Object* base_object = object->FindBaseObject();
+
+        switch (base_object->SuperClassID())
+        {
+          case LIGHT_CLASS_ID:
+            return MaxSceneEntities::NodeType::Light;
+
+          case CAMERA_CLASS_ID:
+            return MaxSceneEntities::NodeType::Camera;
+
+          case HELPER_CLASS_ID:
+            return MaxSceneEntities::NodeType::Helper;
+
+          case SHAPE_CLASS_ID:
+          case GEOMOBJECT_CLASS_ID:
+            return
+                is_particle_system(base_object)
+                    ? MaxSceneEntities::NodeType::Particles
+                    : MaxSceneEntities::NodeType::Geometry;
+
+          default:
+            return MaxSceneEntities::NodeType::Other;
+        }
+    }
+}
+
 
 //
 // MaxSceneEntities class implementation.
@@ -43,7 +91,12 @@
 
 void MaxSceneEntities::clear()
 {
+    foundation::clear_release_memory(m_nodes);
+    foundation::clear_release_memory(m_object_candidates);
     foundation::clear_release_memory(m_objects);
+    foundation::clear_release_memory(m_object_states);
+    foundation::clear_release_memory(m_object_costs);
+    foundation::clear_release_memory(m_export_order);
     foundation::clear_release_memory(m_lights);
 }
 
@@ -52,56 +105,131 @@ void MaxSceneEntities::clear()
 // MaxSceneEntityCollector class implementation.
 //
 
-MaxSceneEntityCollector::MaxSceneEntityCollector(MaxSceneEntities& entities)
+MaxSceneEntityCollector::MaxSceneEntityCollector(
+    MaxSceneEntities&   entities,
+    const TimeValue     time)
   : m_entities(entities)
+  , m_time(time)
 {
 }
 
-void MaxSceneEntityCollector::collect(INode* node)
+void MaxSceneEntityCollector::collect(INode* scene)
 {
-    // Recurse into children.
-    for (int i = 0, e = node->NumberOfChildren(); i < e; ++i)
-        collect(node->GetChildNode(i));
-
-    // Skip non-renderable nodes.
-    if (!node->Renderable())
-        return;
-
-    // Retrieve the ObjectState structure of this node.
-    ObjectState object_state = node->EvalWorldState(0);
-    if (object_state.obj == nullptr)
-        return;
+    // Walk the scene depth-first, visiting children in order.
+    std::vector<std::pair<INode*, size_t>> stack;
+    stack.push_back(std::make_pair(scene, static_cast<size_t>(MaxSceneEntities::NoParent)));
 
-    switch (object_state.obj->SuperClassID())
+    while (!stack.empty())
     {
-      case LIGHT_CLASS_ID:
-        {
-            // Hidden lights still emit light.
+        INode* node = stack.back().first;
+        const size_t parent = stack.back().second;
+        stack.pop_back();
 
-            LightObject* light_object = static_cast<LightObject*>(object_state.obj);
+        const size_t node_index = m_entities.m_nodes.size();
 
-            // Collect this light, even if it is disabled.
-            MaxSceneEntities::LightInfo light_info;
-            light_info.m_light = node;
-            light_info.m_enabled = light_object->GetUseLight() != 0;
-            m_entities.m_lights.push_back(light_info);
-        }
-        break;
+        MaxSceneEntities::NodeInfo node_info;
+        node_info.m_node = node;
+        node_info.m_parent = parent;
+        node_info.m_type = classify_node(node);
+        node_info.m_renderable = node->Renderable() != 0;
+        node_info.m_triangle_count = 0;
 
-      case SHAPE_CLASS_ID:
-      case GEOMOBJECT_CLASS_ID:
+        for (int i = node->NumberOfChildren(); i > 0; --i)
+            stack.push_back(std::make_pair(node->GetChildNode(i - 1), node_index));
+
+        switch (node_info.m_type)
         {
+          case MaxSceneEntities::NodeType::Light:
+            if (node_info.m_renderable)
+            {
+                // Hidden lights still emit light.
+
+                const ObjectState object_state = node->EvalWorldState(m_time);
+                if (object_state.obj != nullptr && object_state.obj->SuperClassID() == LIGHT_CLASS_ID)
+                {
+                    LightObject* light_object = static_cast<LightObject*>(object_state.obj);
+
+                    // Collect this light, even if it is disabled.
+                    MaxSceneEntities::LightInfo light_info;
+                    light_info.m_light = node;
+                    light_info.m_enabled = light_object->GetUseLight() != 0;
+                    m_entities.m_lights.push_back(light_info);
+                }
+            }
+            break;
+
+          case MaxSceneEntities::NodeType::Geometry:
+          case MaxSceneEntities::NodeType::Particles:
             // Skip hidden objects. Hidden mesh lights will not emit light.
             if (node->IsNodeHidden(TRUE))
-                return;
+                node_info.m_renderable = false;
 
-            // Skip non-renderable objects.
-            if (!object_state.obj->IsRenderable())
-                return;
+            // Collect this instance. Its renderability is checked in evaluate_objects().
+            if (node_info.m_renderable)
+            {
+                m_entities.m_object_candidates.push_back(node);
+                m_candidate_nodes.push_back(node_index);
+            }
+            break;
 
-            // Collect this instance.
-            m_entities.m_objects.push_back(node);
+          default:
+            if (node->IsNodeHidden(TRUE))
+                node_info.m_renderable = false;
+            break;
         }
-        break;
+
+        m_entities.m_nodes.push_back(node_info);
+    }
+}
+
+void MaxSceneEntityCollector::evaluate_objects()
+{
+    m_entities.m_objects.clear();
+    m_entities.m_object_states.clear();
+    m_entities.m_object_costs.clear();
+    m_entities.m_export_order.clear();
+
+    for (size_t i = 0, e = m_entities.m_object_candidates.size(); i < e; ++i)
+    {
+        INode* node = m_entities.m_object_candidates[i];
+        MaxSceneEntities::NodeInfo& node_info = m_entities.m_nodes[m_candidate_nodes[i]];
+
+        // Retrieve the ObjectState structure of this node.
+        const ObjectState object_state = node->EvalWorldState(m_time);
+        node_info.m_renderable = false;
+        if (object_state.obj == nullptr)
+            continue;
+
+        const SClass_ID super_class_id = object_state.obj->SuperClassID();
+        if (super_class_id != SHAPE_CLASS_ID && super_class_id != GEOMOBJECT_CLASS_ID)
+            continue;
+
+        // Skip non-renderable objects.
+        if (!object_state.obj->IsRenderable())
+            continue;
+
+        // Estimate the cost of exporting this instance from its face count.
+        // Polygon objects report polygons rather than triangles.
+        int face_count = 0, vertex_count = 0;
+        object_state.obj->PolygonCount(m_time, face_count, vertex_count);
+
+        node_info.m_renderable = true;
+        node_info.m_triangle_count = static_cast<size_t>(std::max(face_count, 0));
+
+        // Collect this instance.
+        m_entities.m_objects.push_back(node);
+        m_entities.m_object_states.push_back(object_state);
+        m_entities.m_object_costs.push_back(node_info.m_triangle_count);
     }
+
+    // Sort instances by decreasing cost so that exporters can schedule the expensive
+    // ones first. Instances of equal cost remain in scene order.
+    m_entities.m_export_order.resize(m_entities.m_objects.size());
+    for (size_t i = 0, e = m_entities.m_export_order.size(); i < e; ++i)
+        m_entities.m_export_order[i] = i;
+    const auto& costs = m_entities.m_object_costs;
+    std::stable_sort(
+        m_entities.m_export_order.begin(),
+        m_entities.m_export_order.end(),
+        [&costs](const size_t lhs, const size_t rhs) { return costs[lhs] > costs[rhs]; });
 }
@@ -28,23 +28,60 @@
 
 #pragma once
 
+// appleseed.foundation headers.
+#include "foundation/platform/windows.h"    // include before 3ds Max headers
+
+// 3ds Max headers.
+#include <maxtypes.h>
+#include <object.h>
+
 // Standard headers.
+#include <cstddef>
 #include <vector>
 
 // Forward declarations.
 class INode;
 
+// Return true if an object is a particle system.
+bool is_particle_system(Object* object);
+
 class MaxSceneEntities
 {
   public:
+    enum class NodeType
+    {
+        Geometry,
+        Particles,
+        Light,
+        Camera,
+        Helper,
+        Other
+    };
+
+    struct NodeInfo
+    {
+        INode*      m_node;
+        size_t      m_parent;               // index of the parent node in m_nodes, or NoParent
+        NodeType    m_type;
+        bool        m_renderable;           // renderable and not hidden
+        size_t      m_triangle_count;       // estimated, only known for evaluated objects
+    };
+
+    static const size_t NoParent = ~size_t(0);
+
     struct LightInfo
     {
         INode*  m_light;
         bool    m_enabled;
     };
 
-    std::vector<INode*>     m_objects;
-    std::vector<LightInfo>  m_lights;
+    std::vector<NodeInfo>       m_nodes;                // all scene nodes, parents before children
+    std::vector<INode*>         m_object_candidates;    // instances RenderBegin() and RenderEnd() are called on
+    std::vector<INode*>         m_objects;              // renderable instances, in scene order
+    std::vector<ObjectState>    m_object_states;        // world state of m_objects[i] at render time
+    std::vector<size_t>         m_object_costs;         // estimated triangle count of m_objects[i]
+    std::vector<size_t>         m_export_order;         // indices into m_objects, most expensive first
+    std::vector<LightInfo>      m_lights;
 
     void clear();
 };
@@ -52,10 +89,24 @@ class MaxSceneEntities
 class MaxSceneEntityCollector
 {
   public:
-    explicit MaxSceneEntityCollector(MaxSceneEntities& entities);
+    MaxSceneEntityCollector(
+        MaxSceneEntities&   entities,
+        const TimeValue     time);
 
+    // Collect and classify the nodes of a scene, lights and candidate object instances.
+    // The scene is walked iteratively so that deep hierarchies don't exhaust the stack.
+    // Objects are not evaluated yet.
     void collect(INode* scene);
 
+    // Evaluate the world state of every candidate object instance once, and keep the
+    // renderable ones sorted by estimated cost. Call this after RenderBegin() so that
+    // render-time settings of modifiers (e.g. TurboSmooth render iterations) are taken
+    // into account. World states are kept for exporters; they remain valid as long as
+    // their nodes are neither evaluated at another time nor modified.
+    void evaluate_objects();
+
   private:
-    MaxSceneEntities& m_entities;
+    MaxSceneEntities&   m_entities;
+    const TimeValue     m_time;
+    std::vector<size_t> m_candidate_nodes;      // index in m_nodes of each object candidate
 };
@@ -0,0 +1,1502 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "meshconversion.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/utility.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/scalar.h"
+#include "foundation/utility/memory.h"
+#include "foundation/utility/string.h"
+
+// Platform headers.
+#ifdef APPLESEED_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+// Standard headers.
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace asf = foundation;
+namespace asr = renderer;
+
+namespace
+{
+    // A vector quantized to a grid whose cell size is the welding tolerance.
+    template <size_t N>
+    struct QuantizedVector
+    {
+        asf::int64 m_coords[N];
+
+        bool operator==(const QuantizedVector& rhs) const
+        {
+            for (size_t i = 0; i < N; ++i)
+            {
+                if (m_coords[i] != rhs.m_coords[i])
+                    return false;
+            }
+
+            return true;
+        }
+    };
+
+    template <size_t N>
+    struct QuantizedVectorHash
+    {
+        size_t operator()(const QuantizedVector<N>& v) const
+        {
+            size_t h = 0;
+            for (size_t i = 0; i < N; ++i)
+                h ^= std::hash<asf::int64>()(v.m_coords[i]) + 0x9E3779B9 + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
+    template <size_t N>
+    QuantizedVector<N> quantize(
+        const asf::Vector<float, N>&    v,
+        const float                     rcp_tolerance)
+    {
+        QuantizedVector<N> q;
+
+        for (size_t i = 0; i < N; ++i)
+        {
+            // Adding zero turns -0.0 into +0.0.
+            const float x = v[i] + 0.0f;
+
+            if (rcp_tolerance > 0.0f)
+                q.m_coords[i] = static_cast<asf::int64>(std::floor(static_cast<double>(x) * rcp_tolerance + 0.5));
+            else
+            {
+                asf::uint32 bits;
+                std::memcpy(&bits, &x, sizeof(bits));
+                q.m_coords[i] = bits;
+            }
+        }
+
+        return q;
+    }
+
+    // Merge values that quantize to the same grid cell. On return, `remap` maps
+    // the index of each input value to the index of its representative.
+    template <size_t N>
+    void weld_values(
+        std::vector<asf::Vector<float, N>>& values,
+        const float                         tolerance,
+        std::vector<asf::uint32>&           remap)
+    {
+        typedef QuantizedVector<N> Key;
+        typedef std::unordered_map<Key, asf::uint32, QuantizedVectorHash<N>> KeyToIndex;
+
+        const float rcp_tolerance = tolerance > 0.0f ? 1.0f / tolerance : 0.0f;
+
+        KeyToIndex key_to_index;
+        key_to_index.reserve(values.size());
+
+        remap.resize(values.size());
+
+        size_t output_count = 0;
+        for (size_t i = 0, e = values.size(); i < e; ++i)
+        {
+            const auto result =
+                key_to_index.insert(
+                    std::make_pair(
+                        quantize(values[i], rcp_tolerance),
+                        static_cast<asf::uint32>(output_count)));
+
+            if (result.second)
+                values[output_count++] = values[i];
+
+            remap[i] = result.first->second;
+        }
+
+        values.resize(output_count);
+        std::vector<asf::Vector<float, N>>(values).swap(values);
+    }
+
+    void remap_index(asf::uint32& index, const std::vector<asf::uint32>& remap)
+    {
+        if (index != asr::Triangle::None)
+            index = remap[index];
+    }
+
+    typedef MeshSnapshot::Triangle Triangle;
+
+    // Accumulate 32-bit values into a 64-bit hash.
+    class ContentHasher
+    {
+      public:
+        ContentHasher()
+          : m_hash(0xCBF29CE484222325ULL)
+        {
+        }
+
+        void append(const asf::uint32 value)
+        {
+            m_hash ^= value;
+            m_hash *= 0x9E3779B97F4A7C15ULL;
+            m_hash ^= m_hash >> 32;
+        }
+
+        void append(const float value)
+        {
+            // Adding zero turns -0.0 into +0.0.
+            const float x = value + 0.0f;
+            asf::uint32 bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+            append(bits);
+        }
+
+        template <typename T, size_t N>
+        void append(const asf::Vector<T, N>& v)
+        {
+            for (size_t i = 0; i < N; ++i)
+                append(static_cast<float>(v[i]));
+        }
+
+        void append(const char* s)
+        {
+            const size_t length = std::strlen(s);
+            append(static_cast<asf::uint32>(length));
+            for (size_t i = 0; i < length; ++i)
+                append(static_cast<asf::uint32>(static_cast<unsigned char>(s[i])));
+        }
+
+        asf::uint64 get() const
+        {
+            return m_hash;
+        }
+
+      private:
+        asf::uint64 m_hash;
+    };
+
+    bool is_degenerate(
+        const std::vector<asf::Vector3f>&   vertices,
+        const Triangle&                     t)
+    {
+        if (t.m_v0 == t.m_v1 || t.m_v1 == t.m_v2 || t.m_v2 == t.m_v0)
+            return true;
+
+        const asf::Vector3f& v0 = vertices[t.m_v0];
+        const asf::Vector3f& v1 = vertices[t.m_v1];
+        const asf::Vector3f& v2 = vertices[t.m_v2];
+
+        return asf::square_norm(asf::cross(v1 - v0, v2 - v0)) == 0.0f;
+    }
+
+    // A triangle of a deforming mesh is only degenerate if it is degenerate at every motion key.
+    bool is_degenerate(
+        const MeshSnapshot&                 snapshot,
+        const Triangle&                     t)
+    {
+        if (!is_degenerate(snapshot.m_vertices, t))
+            return false;
+
+        for (const auto& pose : snapshot.m_vertex_poses)
+        {
+            if (!is_degenerate(pose, t))
+                return false;
+        }
+
+        return true;
+    }
+
+    // Identifies a triangle by its vertices and material, regardless of the first vertex
+    // but preserving the winding order. All other attributes are ignored.
+    struct TriangleKey
+    {
+        asf::uint32 m_v[3];
+        asf::uint16 m_mtlid;
+
+        explicit TriangleKey(const Triangle& t)
+          : m_mtlid(t.m_mtlid)
+        {
+            if (t.m_v0 < t.m_v1 && t.m_v0 < t.m_v2)
+            {
+                m_v[0] = t.m_v0; m_v[1] = t.m_v1; m_v[2] = t.m_v2;
+            }
+            else if (t.m_v1 < t.m_v2)
+            {
+                m_v[0] = t.m_v1; m_v[1] = t.m_v2; m_v[2] = t.m_v0;
+            }
+            else
+            {
+                m_v[0] = t.m_v2; m_v[1] = t.m_v0; m_v[2] = t.m_v1;
+            }
+        }
+
+        bool operator==(const TriangleKey& rhs) const
+        {
+            return
+                m_v[0] == rhs.m_v[0] &&
+                m_v[1] == rhs.m_v[1] &&
+                m_v[2] == rhs.m_v[2] &&
+                m_mtlid == rhs.m_mtlid;
+        }
+    };
+
+    struct TriangleKeyHash
+    {
+        size_t operator()(const TriangleKey& k) const
+        {
+            size_t h = k.m_mtlid;
+            for (size_t i = 0; i < 3; ++i)
+                h ^= std::hash<asf::uint32>()(k.m_v[i]) + 0x9E3779B9 + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
+    // Spread the 10 lower bits of x so that there are two zero bits between each of them.
+    asf::uint32 spread_bits(asf::uint32 x)
+    {
+        x &= 0x000003FF;
+        x = (x | (x << 16)) & 0x030000FF;
+        x = (x | (x <<  8)) & 0x0300F00F;
+        x = (x | (x <<  4)) & 0x030C30C3;
+        x = (x | (x <<  2)) & 0x09249249;
+        return x;
+    }
+
+    // Compute the 30-bit Morton code of a point inside a bounding box.
+    asf::uint32 morton_code(
+        const asf::Vector3f&    p,
+        const asf::Vector3f&    bbox_min,
+        const asf::Vector3f&    bbox_rcp_extent)
+    {
+        asf::uint32 code = 0;
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            const float x = asf::saturate((p[i] - bbox_min[i]) * bbox_rcp_extent[i]);
+            code |= spread_bits(static_cast<asf::uint32>(x * 1023.0f)) << (2 - i);
+        }
+
+        return code;
+    }
+
+    // Renumber the values of a vertex attribute in order of first use by the triangles,
+    // dropping unused values. Arrays in `poses`, if any, are indexed like `values` and are
+    // renumbered the same way. Return the number of values that were dropped.
+    template <typename T>
+    size_t renumber_by_first_use(
+        std::vector<T>&                 values,
+        std::vector<Triangle>&          triangles,
+        asf::uint32 Triangle::*         i0,
+        asf::uint32 Triangle::*         i1,
+        asf::uint32 Triangle::*         i2,
+        std::vector<std::vector<T>>*    poses = nullptr)
+    {
+        const asf::uint32 Unused = ~asf::uint32(0);
+        std::vector<asf::uint32> remap(values.size(), Unused);
+
+        std::vector<T> new_values;
+        new_values.reserve(values.size());
+
+        asf::uint32 Triangle::* const members[3] = { i0, i1, i2 };
+        for (auto& t : triangles)
+        {
+            for (size_t i = 0; i < 3; ++i)
+            {
+                asf::uint32& index = t.*members[i];
+                if (index == asr::Triangle::None)
+                    continue;
+
+                if (remap[index] == Unused)
+                {
+                    remap[index] = static_cast<asf::uint32>(new_values.size());
+                    new_values.push_back(values[index]);
+                }
+
+                index = remap[index];
+            }
+        }
+
+        if (poses != nullptr)
+        {
+            std::vector<T> new_pose(new_values.size());
+            for (auto& pose : *poses)
+            {
+                for (size_t i = 0, e = remap.size(); i < e; ++i)
+                {
+                    if (remap[i] != Unused)
+                        new_pose[remap[i]] = pose[i];
+                }
+                pose.swap(new_pose);
+                new_pose.resize(new_values.size());
+            }
+        }
+
+        const size_t dropped_count = values.size() - new_values.size();
+        values.swap(new_values);
+
+        return dropped_count;
+    }
+
+    asf::uint64 make_edge_key(const asf::uint32 a, const asf::uint32 b)
+    {
+        return
+            a < b
+                ? (static_cast<asf::uint64>(a) << 32) | b
+                : (static_cast<asf::uint64>(b) << 32) | a;
+    }
+
+    // Insert the average of the values at both ends of each edge of the triangles. The index of
+    // the midpoint of the edge starting at corner i of triangle t is stored in midpoints[t * 3 + i].
+    template <typename T>
+    void split_edges_linearly(
+        std::vector<T>&                 values,
+        const std::vector<Triangle>&    triangles,
+        asf::uint32 Triangle::*         i0,
+        asf::uint32 Triangle::*         i1,
+        asf::uint32 Triangle::*         i2,
+        std::vector<asf::uint32>&       midpoints)
+    {
+        std::unordered_map<asf::uint64, asf::uint32> edges;
+        edges.reserve(triangles.size() * 3 / 2);
+        midpoints.resize(triangles.size() * 3);
+
+        asf::uint32 Triangle::* const members[3] = { i0, i1, i2 };
+        for (size_t t = 0, e = triangles.size(); t < e; ++t)
+        {
+            for (size_t i = 0; i < 3; ++i)
+            {
+                const asf::uint32 a = triangles[t].*members[i];
+                const asf::uint32 b = triangles[t].*members[(i + 1) % 3];
+                asf::uint32& midpoint = midpoints[t * 3 + i];
+
+                if (a == asr::Triangle::None || b == asr::Triangle::None)
+                {
+                    midpoint = asr::Triangle::None;
+                    continue;
+                }
+
+                const auto result =
+                    edges.insert(std::make_pair(make_edge_key(a, b), static_cast<asf::uint32>(values.size())));
+                if (result.second)
+                {
+                    const T value = (values[a] + values[b]) * 0.5f;
+                    values.push_back(value);
+                }
+
+                midpoint = result.first->second;
+            }
+        }
+    }
+
+    // Same as split_edges_linearly() for vertex positions, following the Loop subdivision rules:
+    // boundary edges and vertices follow the cubic B-spline rules, and vertices touching
+    // non-manifold edges don't move.
+    void split_edges_loop(
+        std::vector<asf::Vector3f>&     vertices,
+        const std::vector<Triangle>&    triangles,
+        std::vector<asf::uint32>&       midpoints)
+    {
+        struct Edge
+        {
+            asf::uint32     m_midpoint;
+            asf::uint32     m_face_count;
+            asf::Vector3f   m_opposite_sum;     // sum of the vertices facing the edge
+        };
+
+        const asf::uint32 vertex_count = static_cast<asf::uint32>(vertices.size());
+
+        std::unordered_map<asf::uint64, Edge> edges;
+        std::vector<asf::uint64> edge_keys;     // in order of creation
+        edges.reserve(triangles.size() * 3 / 2);
+        edge_keys.reserve(triangles.size() * 3 / 2);
+        midpoints.resize(triangles.size() * 3);
+
+        asf::uint32 Triangle::* const members[3] = { &Triangle::m_v0, &Triangle::m_v1, &Triangle::m_v2 };
+        for (size_t t = 0, e = triangles.size(); t < e; ++t)
+        {
+            for (size_t i = 0; i < 3; ++i)
+            {
+                const asf::uint32 a = triangles[t].*members[i];
+                const asf::uint32 b = triangles[t].*members[(i + 1) % 3];
+                const asf::uint32 c = triangles[t].*members[(i + 2) % 3];
+
+                const asf::uint64 key = make_edge_key(a, b);
+                auto it = edges.find(key);
+                if (it == edges.end())
+                {
+                    Edge edge;
+                    edge.m_midpoint = vertex_count + static_cast<asf::uint32>(edge_keys.size());
+                    edge.m_face_count = 0;
+                    edge.m_opposite_sum = asf::Vector3f(0.0f);
+                    it = edges.insert(std::make_pair(key, edge)).first;
+                    edge_keys.push_back(key);
+                }
+
+                ++it->second.m_face_count;
+                it->second.m_opposite_sum += vertices[c];
+                midpoints[t * 3 + i] = it->second.m_midpoint;
+            }
+        }
+
+        std::vector<asf::Vector3f> new_vertices(vertex_count + edge_keys.size());
+        std::vector<asf::Vector3f> neighbor_sums(vertex_count, asf::Vector3f(0.0f));
+        std::vector<asf::Vector3f> boundary_sums(vertex_count, asf::Vector3f(0.0f));
+        std::vector<asf::uint32> valences(vertex_count, 0);
+        std::vector<asf::uint32> boundary_valences(vertex_count, 0);
+        std::vector<bool> pinned(vertex_count, false);
+
+        // Compute edge points and gather the neighbors of each vertex.
+        for (const auto key : edge_keys)
+        {
+            const asf::uint32 a = static_cast<asf::uint32>(key >> 32);
+            const asf::uint32 b = static_cast<asf::uint32>(key);
+            const Edge& edge = edges.find(key)->second;
+
+            new_vertices[edge.m_midpoint] =
+                edge.m_face_count == 2
+                    ? (vertices[a] + vertices[b]) * 0.375f + edge.m_opposite_sum * 0.125f
+                    : (vertices[a] + vertices[b]) * 0.5f;
+
+            neighbor_sums[a] += vertices[b];
+            neighbor_sums[b] += vertices[a];
+            ++valences[a];
+            ++valences[b];
+
+            if (edge.m_face_count == 1)
+            {
+                boundary_sums[a] += vertices[b];
+                boundary_sums[b] += vertices[a];
+                ++boundary_valences[a];
+                ++boundary_valences[b];
+            }
+            else if (edge.m_face_count > 2)
+            {
+                pinned[a] = true;
+                pinned[b] = true;
+            }
+        }
+
+        // Compute vertex points.
+        for (asf::uint32 v = 0; v < vertex_count; ++v)
+        {
+            const asf::uint32 n = valences[v];
+
+            if (pinned[v] || n == 0)
+                new_vertices[v] = vertices[v];
+            else if (boundary_valences[v] == 2)
+                new_vertices[v] = vertices[v] * 0.75f + boundary_sums[v] * 0.125f;
+            else if (boundary_valences[v] > 0)
+                new_vertices[v] = vertices[v];
+            else
+            {
+                const float beta = n == 3 ? 3.0f / 16.0f : 3.0f / (8.0f * n);
+                new_vertices[v] = vertices[v] * (1.0f - n * beta) + neighbor_sums[v] * beta;
+            }
+        }
+
+        vertices.swap(new_vertices);
+    }
+
+    Triangle make_triangle(
+        const asf::uint16               mtlid,
+        const asf::uint32               v0,
+        const asf::uint32               v1,
+        const asf::uint32               v2,
+        const asf::uint32               n0,
+        const asf::uint32               n1,
+        const asf::uint32               n2,
+        const asf::uint32               a0,
+        const asf::uint32               a1,
+        const asf::uint32               a2)
+    {
+        Triangle t;
+        t.m_v0 = v0;
+        t.m_v1 = v1;
+        t.m_v2 = v2;
+        t.m_n0 = n0;
+        t.m_n1 = n1;
+        t.m_n2 = n2;
+        t.m_a0 = a0;
+        t.m_a1 = a1;
+        t.m_a2 = a2;
+        t.m_mtlid = mtlid;
+        return t;
+    }
+
+    static_assert(
+        sizeof(asf::Vector3f) == 3 * sizeof(float),
+        "foundation::Vector3f is expected to be tightly packed");
+
+    // A 3x4 matrix stored row by row: row i is (m[i][0], m[i][1], m[i][2], m[i][3]).
+    struct Matrix3x4f
+    {
+        float m[3][4];
+    };
+
+    Matrix3x4f get_point_matrix(const asf::Transformf& transform)
+    {
+        const asf::Matrix4f& l = transform.get_local_to_parent();
+
+        Matrix3x4f result;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            for (size_t j = 0; j < 4; ++j)
+                result.m[i][j] = l(i, j);
+        }
+
+        return result;
+    }
+
+    Matrix3x4f get_normal_matrix(const asf::Transformf& transform)
+    {
+        // Normals are transformed by the transpose of the inverse of the linear part.
+        const asf::Matrix4f& p = transform.get_parent_to_local();
+
+        Matrix3x4f result;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            for (size_t j = 0; j < 3; ++j)
+                result.m[i][j] = p(j, i);
+            result.m[i][3] = 0.0f;
+        }
+
+        return result;
+    }
+
+    void transform_scalar(
+        const Matrix3x4f&       m,
+        const asf::Vector3f*    input,
+        asf::Vector3f*          output,
+        const size_t            count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const asf::Vector3f v = input[i];
+            output[i] =
+                asf::Vector3f(
+                    m.m[0][0] * v.x + m.m[0][1] * v.y + m.m[0][2] * v.z + m.m[0][3],
+                    m.m[1][0] * v.x + m.m[1][1] * v.y + m.m[1][2] * v.z + m.m[1][3],
+                    m.m[2][0] * v.x + m.m[2][1] * v.y + m.m[2][2] * v.z + m.m[2][3]);
+        }
+    }
+
+    void normalize_scalar(
+        asf::Vector3f*          values,
+        const size_t            count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            values[i] = asf::safe_normalize(values[i]);
+    }
+
+#ifdef APPLESEED_USE_SSE
+
+    // Shuffle helper: returns (a[i0], a[i1], b[i2], b[i3]).
+    #define SHUFFLE_PS(a, b, i0, i1, i2, i3) _mm_shuffle_ps(a, b, _MM_SHUFFLE(i3, i2, i1, i0))
+
+    // Load 4 consecutive 3D vectors and transpose them to structure-of-arrays form.
+    void load_soa(const asf::Vector3f* input, __m128& x, __m128& y, __m128& z)
+    {
+        const float* p = &input[0].x;
+        const __m128 a = _mm_loadu_ps(p + 0);       // x0 y0 z0 x1
+        const __m128 b = _mm_loadu_ps(p + 4);       // y1 z1 x2 y2
+        const __m128 c = _mm_loadu_ps(p + 8);       // z2 x3 y3 z3
+
+        x = SHUFFLE_PS(SHUFFLE_PS(a, a, 0, 3, 0, 3), SHUFFLE_PS(b, c, 2, 2, 1, 1), 0, 1, 0, 2);
+        y = SHUFFLE_PS(SHUFFLE_PS(a, b, 1, 1, 0, 0), SHUFFLE_PS(b, c, 3, 3, 2, 2), 0, 2, 0, 2);
+        z = SHUFFLE_PS(SHUFFLE_PS(a, b, 2, 2, 1, 1), SHUFFLE_PS(c, c, 0, 3, 0, 3), 0, 2, 0, 1);
+    }
+
+    // Transpose 4 3D vectors from structure-of-arrays form and store them consecutively.
+    void store_soa(asf::Vector3f* output, const __m128& x, const __m128& y, const __m128& z)
+    {
+        float* p = &output[0].x;
+        _mm_storeu_ps(p + 0, SHUFFLE_PS(SHUFFLE_PS(x, y, 0, 0, 0, 0), SHUFFLE_PS(z, x, 0, 0, 1, 1), 0, 2, 0, 2));
+        _mm_storeu_ps(p + 4, SHUFFLE_PS(SHUFFLE_PS(y, z, 1, 1, 1, 1), SHUFFLE_PS(x, y, 2, 2, 2, 2), 0, 2, 0, 2));
+        _mm_storeu_ps(p + 8, SHUFFLE_PS(SHUFFLE_PS(z, x, 2, 2, 3, 3), SHUFFLE_PS(y, z, 3, 3, 3, 3), 0, 2, 0, 2));
+    }
+
+    #undef SHUFFLE_PS
+
+    struct Matrix3x4SSE
+    {
+        __m128 m[3][4];
+
+        explicit Matrix3x4SSE(const Matrix3x4f& rhs)
+        {
+            for (size_t i = 0; i < 3; ++i)
+            {
+                for (size_t j = 0; j < 4; ++j)
+                    m[i][j] = _mm_set1_ps(rhs.m[i][j]);
+            }
+        }
+    };
+
+    void transform_soa(
+        const Matrix3x4SSE&     m,
+        __m128&                 x,
+        __m128&                 y,
+        __m128&                 z)
+    {
+        const __m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.m[0][0], x), _mm_mul_ps(m.m[0][1], y)), _mm_add_ps(_mm_mul_ps(m.m[0][2], z), m.m[0][3]));
+        const __m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.m[1][0], x), _mm_mul_ps(m.m[1][1], y)), _mm_add_ps(_mm_mul_ps(m.m[1][2], z), m.m[1][3]));
+        const __m128 tz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.m[2][0], x), _mm_mul_ps(m.m[2][1], y)), _mm_add_ps(_mm_mul_ps(m.m[2][2], z), m.m[2][3]));
+        x = tx;
+        y = ty;
+        z = tz;
+    }
+
+    void transform_sse(
+        const Matrix3x4f&       matrix,
+        const bool              normalize,
+        const asf::Vector3f*    input,
+        asf::Vector3f*          output,
+        const size_t            count)
+    {
+        const Matrix3x4SSE m(matrix);
+        const __m128 zero = _mm_setzero_ps();
+
+        const size_t simd_count = count & ~size_t(3);
+        for (size_t i = 0; i < simd_count; i += 4)
+        {
+            __m128 x, y, z;
+            load_soa(input + i, x, y, z);
+            transform_soa(m, x, y, z);
+
+            if (normalize)
+            {
+                const __m128 square_norm =
+                    _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+
+                // Zero-length vectors are handled by the scalar code below.
+                if (_mm_movemask_ps(_mm_cmpgt_ps(square_norm, zero)) == 0xF)
+                {
+                    const __m128 norm = _mm_sqrt_ps(square_norm);
+                    x = _mm_div_ps(x, norm);
+                    y = _mm_div_ps(y, norm);
+                    z = _mm_div_ps(z, norm);
+                    store_soa(output + i, x, y, z);
+                }
+                else
+                {
+                    store_soa(output + i, x, y, z);
+                    normalize_scalar(output + i, 4);
+                }
+            }
+            else store_soa(output + i, x, y, z);
+        }
+
+        // Process the remaining vectors.
+        transform_scalar(matrix, input + simd_count, output + simd_count, count - simd_count);
+        if (normalize)
+            normalize_scalar(output + simd_count, count - simd_count);
+    }
+
+#endif
+
+    void transform_vectors(
+        const Matrix3x4f&       matrix,
+        const bool              normalize,
+        const asf::Vector3f*    input,
+        asf::Vector3f*          output,
+        const size_t            count)
+    {
+#ifdef APPLESEED_USE_SSE
+        transform_sse(matrix, normalize, input, output, count);
+#else
+        transform_scalar(matrix, input, output, count);
+        if (normalize)
+            normalize_scalar(output, count);
+#endif
+    }
+}
+
+
+//
+// MaterialSlotMap class implementation.
+//
+
+void MaterialSlotMap::insert(const asf::uint16 mtlid, const asf::uint32 slot)
+{
+    assert(get_slot(mtlid) == InvalidSlot);
+
+    if (mtlid < DenseLimit)
+    {
+        if (mtlid >= m_dense.size())
+            m_dense.resize(mtlid + 1, static_cast<asf::uint32>(InvalidSlot));
+        m_dense[mtlid] = slot;
+    }
+    else
+    {
+        const Entry entry(mtlid, slot);
+        m_sparse.insert(std::lower_bound(m_sparse.begin(), m_sparse.end(), entry), entry);
+    }
+
+    m_entries.push_back(Entry(mtlid, slot));
+}
+
+void MaterialSlotMap::clear()
+{
+    m_dense.clear();
+    m_sparse.clear();
+    m_entries.clear();
+}
+
+asf::uint32 MaterialSlotMap::get_sparse_slot(const asf::uint16 mtlid) const
+{
+    const auto it =
+        std::lower_bound(
+            m_sparse.begin(),
+            m_sparse.end(),
+            Entry(mtlid, 0));
+
+    return it != m_sparse.end() && it->first == mtlid ? it->second : InvalidSlot;
+}
+
+
+//
+// MeshSnapshot class implementation.
+//
+
+MeshSnapshot::MeshSnapshot()
+  : m_transform(asf::Transformf::identity())
+  , m_border_triangle_count(0)
+{
+}
+
+void MeshSnapshot::swap(MeshSnapshot& rhs)
+{
+    std::swap(m_transform, rhs.m_transform);
+    m_vertices.swap(rhs.m_vertices);
+    m_vertex_poses.swap(rhs.m_vertex_poses);
+    m_vertex_normals.swap(rhs.m_vertex_normals);
+    m_normal_poses.swap(rhs.m_normal_poses);
+    m_tex_coords.swap(rhs.m_tex_coords);
+    m_triangles.swap(rhs.m_triangles);
+    std::swap(m_border_triangle_count, rhs.m_border_triangle_count);
+}
+
+void MeshSnapshot::clear()
+{
+    asf::clear_release_memory(m_vertices);
+    asf::clear_release_memory(m_vertex_poses);
+    asf::clear_release_memory(m_vertex_normals);
+    asf::clear_release_memory(m_normal_poses);
+    asf::clear_release_memory(m_tex_coords);
+    asf::clear_release_memory(m_triangles);
+    m_border_triangle_count = 0;
+}
+
+
+//
+// MeshConversionParams class implementation.
+//
+
+MeshConversionParams::MeshConversionParams()
+  : m_weld_vertex_attributes(false)
+  , m_weld_tolerance(0.0f)
+  , m_optimize(false)
+  , m_subdivision_iterations(0)
+{
+}
+
+bool MeshConversionParams::operator==(const MeshConversionParams& rhs) const
+{
+    return
+        m_weld_vertex_attributes == rhs.m_weld_vertex_attributes &&
+        m_weld_tolerance == rhs.m_weld_tolerance &&
+        m_optimize == rhs.m_optimize &&
+        m_subdivision_iterations == rhs.m_subdivision_iterations &&
+        m_map_channels == rhs.m_map_channels;
+}
+
+bool MeshConversionParams::operator!=(const MeshConversionParams& rhs) const
+{
+    return !(*this == rhs);
+}
+
+
+//
+// MeshConversionStats class implementation.
+//
+
+MeshConversionStats::MeshConversionStats()
+  : m_triangle_count(0)
+  , m_input_vertex_normal_count(0)
+  , m_output_vertex_normal_count(0)
+  , m_input_tex_coords_count(0)
+  , m_output_tex_coords_count(0)
+  , m_degenerate_triangle_count(0)
+  , m_duplicate_triangle_count(0)
+  , m_unused_vertex_count(0)
+{
+}
+
+MeshConversionStats& MeshConversionStats::operator+=(const MeshConversionStats& rhs)
+{
+    m_triangle_count += rhs.m_triangle_count;
+    m_input_vertex_normal_count += rhs.m_input_vertex_normal_count;
+    m_output_vertex_normal_count += rhs.m_output_vertex_normal_count;
+    m_input_tex_coords_count += rhs.m_input_tex_coords_count;
+    m_output_tex_coords_count += rhs.m_output_tex_coords_count;
+    m_degenerate_triangle_count += rhs.m_degenerate_triangle_count;
+    m_duplicate_triangle_count += rhs.m_duplicate_triangle_count;
+    m_unused_vertex_count += rhs.m_unused_vertex_count;
+    return *this;
+}
+
+
+//
+// MeshConversionJob class implementation.
+//
+
+MeshConversionJob::MeshConversionJob()
+  : m_content_hash(0)
+  , m_keep_snapshot(false)
+  , m_snapshot_processed(false)
+  , m_convert(true)
+{
+}
+
+void MeshConversionJob::execute()
+{
+    if (!m_snapshot_processed && (m_params.m_subdivision_iterations > 0 || m_snapshot.m_border_triangle_count > 0))
+        subdivide_mesh_snapshot(m_snapshot, static_cast<size_t>(m_params.m_subdivision_iterations));
+
+    m_stats.m_triangle_count = m_snapshot.m_triangles.size();
+    m_stats.m_input_vertex_normal_count = m_snapshot.m_vertex_normals.size();
+    m_stats.m_input_tex_coords_count = m_snapshot.m_tex_coords.size();
+
+    if (!m_snapshot_processed)
+    {
+        if (m_params.m_weld_vertex_attributes)
+            weld_vertex_attributes(m_snapshot, m_params.m_weld_tolerance);
+
+        if (m_params.m_optimize)
+            optimize_mesh_snapshot(m_snapshot, m_stats);
+
+        m_snapshot_processed = true;
+    }
+
+    m_stats.m_output_vertex_normal_count = m_snapshot.m_vertex_normals.size();
+    m_stats.m_output_tex_coords_count = m_snapshot.m_tex_coords.size();
+
+    if (m_convert)
+        m_object = convert_mesh_snapshot(m_snapshot, m_name.c_str(), m_mtlid_to_slot);
+
+    if (!m_keep_snapshot)
+        m_snapshot.clear();
+}
+
+
+//
+// Mesh conversion functions implementation.
+//
+
+void subdivide_mesh_snapshot(
+    MeshSnapshot&                   snapshot,
+    const size_t                    iterations)
+{
+    for (size_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        const std::vector<Triangle>& triangles = snapshot.m_triangles;
+
+        std::vector<asf::uint32> vertex_midpoints;
+        split_edges_loop(snapshot.m_vertices, triangles, vertex_midpoints);
+
+        // Poses share the topology of the mesh, hence they get the same midpoints.
+        for (auto& pose : snapshot.m_vertex_poses)
+        {
+            std::vector<asf::uint32> pose_midpoints;
+            split_edges_loop(pose, triangles, pose_midpoints);
+        }
+
+        // Vertex normals and texture coordinates are interpolated linearly.
+        std::vector<asf::uint32> normal_midpoints;
+        split_edges_linearly(
+            snapshot.m_vertex_normals,
+            triangles,
+            &Triangle::m_n0, &Triangle::m_n1, &Triangle::m_n2,
+            normal_midpoints);
+
+        for (auto& pose : snapshot.m_normal_poses)
+        {
+            std::vector<asf::uint32> pose_midpoints;
+            split_edges_linearly(
+                pose,
+                triangles,
+                &Triangle::m_n0, &Triangle::m_n1, &Triangle::m_n2,
+                pose_midpoints);
+        }
+
+        std::vector<asf::uint32> tex_coords_midpoints;
+        split_edges_linearly(
+            snapshot.m_tex_coords,
+            triangles,
+            &Triangle::m_a0, &Triangle::m_a1, &Triangle::m_a2,
+            tex_coords_midpoints);
+
+        // Split each triangle into three corner triangles and a center triangle.
+        std::vector<Triangle> new_triangles;
+        new_triangles.reserve(triangles.size() * 4);
+        for (size_t t = 0, e = triangles.size(); t < e; ++t)
+        {
+            const Triangle& tri = triangles[t];
+            const asf::uint32 v[3] = { tri.m_v0, tri.m_v1, tri.m_v2 };
+            const asf::uint32 n[3] = { tri.m_n0, tri.m_n1, tri.m_n2 };
+            const asf::uint32 a[3] = { tri.m_a0, tri.m_a1, tri.m_a2 };
+            const asf::uint32* vm = &vertex_midpoints[t * 3];
+            const asf::uint32* nm = &normal_midpoints[t * 3];
+            const asf::uint32* am = &tex_coords_midpoints[t * 3];
+
+            for (size_t i = 0; i < 3; ++i)
+            {
+                const size_t j = (i + 2) % 3;
+                new_triangles.push_back(
+                    make_triangle(
+                        tri.m_mtlid,
+                        v[i], vm[i], vm[j],
+                        n[i], nm[i], nm[j],
+                        a[i], am[i], am[j]));
+            }
+
+            new_triangles.push_back(
+                make_triangle(
+                    tri.m_mtlid,
+                    vm[0], vm[1], vm[2],
+                    nm[0], nm[1], nm[2],
+                    am[0], am[1], am[2]));
+        }
+
+        snapshot.m_triangles.swap(new_triangles);
+    }
+
+    if (snapshot.m_border_triangle_count > 0)
+    {
+        // Each triangle was split into 4^iterations triangles that directly follow
+        // those of the previous triangle, so border triangles are still at the end.
+        const size_t split_count = static_cast<size_t>(1) << (2 * iterations);
+        const size_t border_count = snapshot.m_border_triangle_count * split_count;
+        snapshot.m_triangles.resize(snapshot.m_triangles.size() - border_count);
+        snapshot.m_border_triangle_count = 0;
+
+        renumber_by_first_use(
+            snapshot.m_vertices,
+            snapshot.m_triangles,
+            &Triangle::m_v0, &Triangle::m_v1, &Triangle::m_v2,
+            &snapshot.m_vertex_poses);
+        renumber_by_first_use(
+            snapshot.m_vertex_normals,
+            snapshot.m_triangles,
+            &Triangle::m_n0, &Triangle::m_n1, &Triangle::m_n2,
+            &snapshot.m_normal_poses);
+        renumber_by_first_use(
+            snapshot.m_tex_coords,
+            snapshot.m_triangles,
+            &Triangle::m_a0, &Triangle::m_a1, &Triangle::m_a2);
+    }
+}
+
+void weld_vertex_attributes(
+    MeshSnapshot&                   snapshot,
+    const float                     tolerance)
+{
+    // Normals are compared by direction only. Posed normals equal at the first motion key
+    // may differ at the next ones, so they are left alone.
+    std::vector<asf::uint32> normal_remap;
+    if (snapshot.m_normal_poses.empty())
+    {
+        for (auto& n : snapshot.m_vertex_normals)
+            n = asf::safe_normalize(n);
+
+        weld_values(snapshot.m_vertex_normals, tolerance, normal_remap);
+    }
+
+    std::vector<asf::uint32> tex_coords_remap;
+    weld_values(snapshot.m_tex_coords, tolerance, tex_coords_remap);
+
+    for (auto& t : snapshot.m_triangles)
+    {
+        if (!normal_remap.empty())
+        {
+            remap_index(t.m_n0, normal_remap);
+            remap_index(t.m_n1, normal_remap);
+            remap_index(t.m_n2, normal_remap);
+        }
+        remap_index(t.m_a0, tex_coords_remap);
+        remap_index(t.m_a1, tex_coords_remap);
+        remap_index(t.m_a2, tex_coords_remap);
+    }
+}
+
+asf::uint64 compute_content_hash(const MeshSnapshot& snapshot)
+{
+    ContentHasher hasher;
+
+    const asf::Matrix4f& m = snapshot.m_transform.get_local_to_parent();
+    for (size_t i = 0; i < 16; ++i)
+        hasher.append(m[i]);
+
+    hasher.append(static_cast<asf::uint32>(snapshot.m_vertices.size()));
+    for (const auto& v : snapshot.m_vertices)
+        hasher.append(v);
+
+    hasher.append(static_cast<asf::uint32>(snapshot.m_vertex_poses.size()));
+    for (const auto& pose : snapshot.m_vertex_poses)
+    {
+        for (const auto& v : pose)
+            hasher.append(v);
+    }
+
+    hasher.append(static_cast<asf::uint32>(snapshot.m_vertex_normals.size()));
+    for (const auto& n : snapshot.m_vertex_normals)
+        hasher.append(n);
+
+    hasher.append(static_cast<asf::uint32>(snapshot.m_normal_poses.size()));
+    for (const auto& pose : snapshot.m_normal_poses)
+    {
+        for (const auto& n : pose)
+            hasher.append(n);
+    }
+
+    hasher.append(static_cast<asf::uint32>(snapshot.m_tex_coords.size()));
+    for (const auto& uv : snapshot.m_tex_coords)
+        hasher.append(uv);
+
+    hasher.append(static_cast<asf::uint32>(snapshot.m_triangles.size()));
+    for (const auto& t : snapshot.m_triangles)
+    {
+        hasher.append(t.m_v0);
+        hasher.append(t.m_v1);
+        hasher.append(t.m_v2);
+        hasher.append(t.m_n0);
+        hasher.append(t.m_n1);
+        hasher.append(t.m_n2);
+        hasher.append(t.m_a0);
+        hasher.append(t.m_a1);
+        hasher.append(t.m_a2);
+        hasher.append(static_cast<asf::uint32>(t.m_mtlid));
+    }
+
+    hasher.append(static_cast<asf::uint32>(snapshot.m_border_triangle_count));
+
+    return hasher.get();
+}
+
+asf::uint64 compute_content_hash(const MeshConversionJobs& jobs)
+{
+    ContentHasher hasher;
+
+    hasher.append(static_cast<asf::uint32>(jobs.size()));
+    for (const auto& job : jobs)
+    {
+        hasher.append(static_cast<asf::uint32>(job->m_content_hash));
+        hasher.append(static_cast<asf::uint32>(job->m_content_hash >> 32));
+        hasher.append(static_cast<asf::uint32>(job->m_params.m_subdivision_iterations));
+    }
+
+    return hasher.get();
+}
+
+bool are_snapshots_identical(const MeshSnapshot& lhs, const MeshSnapshot& rhs)
+{
+    if (lhs.m_transform.get_local_to_parent() != rhs.m_transform.get_local_to_parent() ||
+        lhs.m_vertices != rhs.m_vertices ||
+        lhs.m_vertex_poses != rhs.m_vertex_poses ||
+        lhs.m_vertex_normals != rhs.m_vertex_normals ||
+        lhs.m_normal_poses != rhs.m_normal_poses ||
+        lhs.m_tex_coords != rhs.m_tex_coords ||
+        lhs.m_triangles.size() != rhs.m_triangles.size() ||
+        lhs.m_border_triangle_count != rhs.m_border_triangle_count)
+        return false;
+
+    for (size_t i = 0, e = lhs.m_triangles.size(); i < e; ++i)
+    {
+        const MeshSnapshot::Triangle& l = lhs.m_triangles[i];
+        const MeshSnapshot::Triangle& r = rhs.m_triangles[i];
+
+        if (l.m_v0 != r.m_v0 || l.m_v1 != r.m_v1 || l.m_v2 != r.m_v2 ||
+            l.m_n0 != r.m_n0 || l.m_n1 != r.m_n1 || l.m_n2 != r.m_n2 ||
+            l.m_a0 != r.m_a0 || l.m_a1 != r.m_a1 || l.m_a2 != r.m_a2 ||
+            l.m_mtlid != r.m_mtlid)
+            return false;
+    }
+
+    return true;
+}
+
+bool are_snapshots_identical(const MeshConversionJobs& lhs, const MeshConversionJobs& rhs)
+{
+    if (lhs.size() != rhs.size())
+        return false;
+
+    for (size_t i = 0, e = lhs.size(); i < e; ++i)
+    {
+        if (lhs[i]->m_params.m_subdivision_iterations != rhs[i]->m_params.m_subdivision_iterations ||
+            !are_snapshots_identical(lhs[i]->m_snapshot, rhs[i]->m_snapshot))
+            return false;
+    }
+
+    return true;
+}
+
+asf::uint64 compute_content_hash(const asr::MeshObject& object)
+{
+    ContentHasher hasher;
+
+    const size_t vertex_count = object.get_vertex_count();
+    hasher.append(static_cast<asf::uint32>(vertex_count));
+    for (size_t i = 0; i < vertex_count; ++i)
+        hasher.append(object.get_vertex(i));
+
+    const size_t motion_segment_count = object.get_motion_segment_count();
+    hasher.append(static_cast<asf::uint32>(motion_segment_count));
+    for (size_t m = 0; m < motion_segment_count; ++m)
+    {
+        for (size_t i = 0; i < vertex_count; ++i)
+            hasher.append(object.get_vertex_pose(i, m));
+    }
+
+    const size_t normal_count = object.get_vertex_normal_count();
+    hasher.append(static_cast<asf::uint32>(normal_count));
+    for (size_t i = 0; i < normal_count; ++i)
+        hasher.append(object.get_vertex_normal(i));
+
+    const size_t tex_coords_count = object.get_tex_coords_count();
+    hasher.append(static_cast<asf::uint32>(tex_coords_count));
+    for (size_t i = 0; i < tex_coords_count; ++i)
+        hasher.append(object.get_tex_coords(i));
+
+    const size_t triangle_count = object.get_triangle_count();
+    hasher.append(static_cast<asf::uint32>(triangle_count));
+    for (size_t i = 0; i < triangle_count; ++i)
+    {
+        const asr::Triangle& t = object.get_triangle(i);
+        hasher.append(t.m_v0);
+        hasher.append(t.m_v1);
+        hasher.append(t.m_v2);
+        hasher.append(t.m_n0);
+        hasher.append(t.m_n1);
+        hasher.append(t.m_n2);
+        hasher.append(t.m_a0);
+        hasher.append(t.m_a1);
+        hasher.append(t.m_a2);
+        hasher.append(t.m_pa);
+    }
+
+    const size_t slot_count = object.get_material_slot_count();
+    hasher.append(static_cast<asf::uint32>(slot_count));
+    for (size_t i = 0; i < slot_count; ++i)
+        hasher.append(object.get_material_slot(i));
+
+    return hasher.get();
+}
+
+size_t estimate_mesh_object_size(const MeshSnapshot& snapshot)
+{
+    return
+        snapshot.m_vertices.size() * (snapshot.m_vertex_poses.size() + 1) * sizeof(asr::GVector3) +
+        snapshot.m_vertex_normals.size() * (snapshot.m_normal_poses.size() + 1) * sizeof(asr::GVector3) +
+        snapshot.m_tex_coords.size() * sizeof(asr::GVector2) +
+        snapshot.m_triangles.size() * sizeof(asr::Triangle);
+}
+
+void transform_points(
+    const asf::Transformf&          transform,
+    const asf::Vector3f*            input,
+    asf::Vector3f*                  output,
+    const size_t                    count)
+{
+    transform_vectors(get_point_matrix(transform), false, input, output, count);
+}
+
+void transform_normals(
+    const asf::Transformf&          transform,
+    const asf::Vector3f*            input,
+    asf::Vector3f*                  output,
+    const size_t                    count)
+{
+    transform_vectors(get_normal_matrix(transform), true, input, output, count);
+}
+
+void optimize_mesh_snapshot(
+    MeshSnapshot&                   snapshot,
+    MeshConversionStats&            stats)
+{
+    std::vector<Triangle>& triangles = snapshot.m_triangles;
+
+    // Remove degenerate and duplicate triangles.
+    std::unordered_set<TriangleKey, TriangleKeyHash> unique_triangles;
+    unique_triangles.reserve(triangles.size());
+    size_t kept_count = 0;
+    for (size_t i = 0, e = triangles.size(); i < e; ++i)
+    {
+        const Triangle& t = triangles[i];
+
+        if (is_degenerate(snapshot, t))
+        {
+            ++stats.m_degenerate_triangle_count;
+            continue;
+        }
+
+        if (!unique_triangles.insert(TriangleKey(t)).second)
+        {
+            ++stats.m_duplicate_triangle_count;
+            continue;
+        }
+
+        triangles[kept_count++] = t;
+    }
+    triangles.resize(kept_count);
+
+    if (!triangles.empty())
+    {
+        // Compute the bounding box of the vertices.
+        asf::Vector3f bbox_min(std::numeric_limits<float>::max());
+        asf::Vector3f bbox_max(-std::numeric_limits<float>::max());
+        for (const auto& v : snapshot.m_vertices)
+        {
+            bbox_min = asf::component_wise_min(bbox_min, v);
+            bbox_max = asf::component_wise_max(bbox_max, v);
+        }
+
+        asf::Vector3f bbox_rcp_extent;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            const float extent = bbox_max[i] - bbox_min[i];
+            bbox_rcp_extent[i] = extent > 0.0f ? 1.0f / extent : 0.0f;
+        }
+
+        // Sort triangles along a Morton curve through their centroids.
+        std::vector<std::pair<asf::uint32, asf::uint32>> sort_keys(triangles.size());
+        for (size_t i = 0, e = triangles.size(); i < e; ++i)
+        {
+            const Triangle& t = triangles[i];
+            const asf::Vector3f centroid =
+                (snapshot.m_vertices[t.m_v0] + snapshot.m_vertices[t.m_v1] + snapshot.m_vertices[t.m_v2]) / 3.0f;
+            sort_keys[i] =
+                std::make_pair(
+                    morton_code(centroid, bbox_min, bbox_rcp_extent),
+                    static_cast<asf::uint32>(i));
+        }
+        std::sort(sort_keys.begin(), sort_keys.end());
+
+        std::vector<Triangle> sorted_triangles;
+        sorted_triangles.reserve(triangles.size());
+        for (const auto& key : sort_keys)
+            sorted_triangles.push_back(triangles[key.second]);
+        triangles.swap(sorted_triangles);
+    }
+
+    // Renumber vertices, vertex normals and texture coordinates in the order
+    // they are used by the sorted triangles, dropping unused ones.
+    stats.m_unused_vertex_count +=
+        renumber_by_first_use(
+            snapshot.m_vertices,
+            triangles,
+            &Triangle::m_v0, &Triangle::m_v1, &Triangle::m_v2,
+            &snapshot.m_vertex_poses);
+    renumber_by_first_use(
+        snapshot.m_vertex_normals,
+        triangles,
+        &Triangle::m_n0, &Triangle::m_n1, &Triangle::m_n2,
+        &snapshot.m_normal_poses);
+    renumber_by_first_use(snapshot.m_tex_coords, triangles, &Triangle::m_a0, &Triangle::m_a1, &Triangle::m_a2);
+}
+
+asf::auto_release_ptr<asr::MeshObject> convert_mesh_snapshot(
+    const MeshSnapshot&             snapshot,
+    const char*                     name,
+    MaterialSlotMap&                mtlid_to_slot)
+{
+    asf::auto_release_ptr<asr::MeshObject> object(
+        asr::MeshObjectFactory().create(name, asr::ParamArray()));
+
+    // Vertices and normals are transformed in blocks to keep the temporary buffer small.
+    const size_t BlockSize = 4096;
+    std::vector<asf::Vector3f> block(BlockSize);
+
+    // Copy vertices to the mesh object.
+    const size_t vertex_count = snapshot.m_vertices.size();
+    object->reserve_vertices(vertex_count);
+    for (size_t begin = 0; begin < vertex_count; begin += BlockSize)
+    {
+        const size_t count = std::min(BlockSize, vertex_count - begin);
+        transform_points(snapshot.m_transform, &snapshot.m_vertices[begin], &block[0], count);
+        for (size_t i = 0; i < count; ++i)
+            object->push_vertex(asr::GVector3(block[i].x, block[i].y, block[i].z));
+    }
+
+    // Copy texture vertices to the mesh object.
+    object->reserve_tex_coords(snapshot.m_tex_coords.size());
+    for (const auto& uv : snapshot.m_tex_coords)
+        object->push_tex_coords(asr::GVector2(uv.x, uv.y));
+
+    // Copy vertex normals to the mesh object.
+    const size_t normal_count = snapshot.m_vertex_normals.size();
+    object->reserve_vertex_normals(normal_count);
+    for (size_t begin = 0; begin < normal_count; begin += BlockSize)
+    {
+        const size_t count = std::min(BlockSize, normal_count - begin);
+        transform_normals(snapshot.m_transform, &snapshot.m_vertex_normals[begin], &block[0], count);
+        for (size_t i = 0; i < count; ++i)
+            object->push_vertex_normal(asr::GVector3(block[i].x, block[i].y, block[i].z));
+    }
+
+    // Copy vertex and vertex normal poses to the mesh object, one per motion segment.
+    const size_t pose_count = snapshot.m_vertex_poses.size();
+    if (pose_count > 0)
+    {
+        object->set_motion_segment_count(pose_count);
+        for (size_t p = 0; p < pose_count; ++p)
+        {
+            const auto& pose = snapshot.m_vertex_poses[p];
+            for (size_t begin = 0; begin < vertex_count; begin += BlockSize)
+            {
+                const size_t count = std::min(BlockSize, vertex_count - begin);
+                transform_points(snapshot.m_transform, &pose[begin], &block[0], count);
+                for (size_t i = 0; i < count; ++i)
+                    object->set_vertex_pose(begin + i, p, asr::GVector3(block[i].x, block[i].y, block[i].z));
+            }
+        }
+
+        for (size_t p = 0, e = snapshot.m_normal_poses.size(); p < e; ++p)
+        {
+            const auto& pose = snapshot.m_normal_poses[p];
+            for (size_t begin = 0; begin < normal_count; begin += BlockSize)
+            {
+                const size_t count = std::min(BlockSize, normal_count - begin);
+                transform_normals(snapshot.m_transform, &pose[begin], &block[0], count);
+                for (size_t i = 0; i < count; ++i)
+                    object->set_vertex_normal_pose(begin + i, p, asr::GVector3(block[i].x, block[i].y, block[i].z));
+            }
+        }
+    }
+
+    // Copy triangles to the mesh object.
+    object->reserve_triangles(snapshot.m_triangles.size());
+    for (const auto& t : snapshot.m_triangles)
+    {
+        asr::Triangle triangle;
+        triangle.m_v0 = t.m_v0;
+        triangle.m_v1 = t.m_v1;
+        triangle.m_v2 = t.m_v2;
+        triangle.m_n0 = t.m_n0;
+        triangle.m_n1 = t.m_n1;
+        triangle.m_n2 = t.m_n2;
+        triangle.m_a0 = t.m_a0;
+        triangle.m_a1 = t.m_a1;
+        triangle.m_a2 = t.m_a2;
+
+        // Assign to the triangle the material slot corresponding to the face's material ID,
+        // creating a new material slot if necessary.
+        asf::uint32 slot = mtlid_to_slot.get_slot(t.m_mtlid);
+        if (slot == MaterialSlotMap::InvalidSlot)
+        {
+            // Create a new material slot in the object.
+            const auto slot_name = "material_slot_" + asf::to_string(object->get_material_slot_count());
+            slot = static_cast<asf::uint32>(object->push_material_slot(slot_name.c_str()));
+            mtlid_to_slot.insert(t.m_mtlid, slot);
+        }
+        triangle.m_pa = slot;
+
+        object->push_triangle(triangle);
+    }
+
+    return object;
+}
+
+void execute_mesh_conversion_jobs(
+    const std::vector<MeshConversionJob*>&  jobs,
+    const size_t                            thread_count)
+{
+    const size_t worker_count = std::min(thread_count, jobs.size());
+
+    if (worker_count <= 1)
+    {
+        for (auto job : jobs)
+            job->execute();
+        return;
+    }
+
+    // Workers fetch jobs in order but may complete them in any order. A worker that fails stops
+    // the others from fetching more jobs; its exception is rethrown once all workers are joined.
+    std::atomic<size_t> next_job(0);
+    std::vector<std::exception_ptr> errors(worker_count);
+    auto worker = [&jobs, &next_job, &errors](const size_t worker_index)
+    {
+        try
+        {
+            while (true)
+            {
+                const size_t job_index = next_job++;
+                if (job_index >= jobs.size())
+                    break;
+                jobs[job_index]->execute();
+            }
+        }
+        catch (...)
+        {
+            errors[worker_index] = std::current_exception();
+            next_job = jobs.size();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(worker_count);
+    try
+    {
+        for (size_t i = 0; i < worker_count; ++i)
+            workers.push_back(std::thread(worker, i));
+    }
+    catch (...)
+    {
+        // Threads could not be started: join the running ones before propagating the error.
+        next_job = jobs.size();
+        for (auto& w : workers)
+            w.join();
+        throw;
+    }
+
+    for (auto& w : workers)
+        w.join();
+
+    for (const auto& error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,261 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.renderer headers.
+#include "renderer/api/object.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/transform.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/autoreleaseptr.h"
+
+// Standard headers.
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+// The code in this file does not depend on the 3ds Max SDK: mesh snapshots are taken
+// on the main thread, then they can be converted to appleseed mesh objects on any thread.
+//
+
+// Map 3ds Max material IDs to appleseed material slots. Material IDs are usually small
+// and dense, so they index a flat table; larger IDs go to a sorted vector.
+class MaterialSlotMap
+{
+  public:
+    typedef std::pair<foundation::uint16, foundation::uint32> Entry;
+
+    static const foundation::uint32 InvalidSlot = ~foundation::uint32(0);
+
+    // Material IDs below this limit are stored in the flat table.
+    static const size_t DenseLimit = 1024;
+
+    // Return the material slot of a given material ID, or InvalidSlot if there is none.
+    foundation::uint32 get_slot(const foundation::uint16 mtlid) const;
+
+    // Assign a material slot to a material ID that does not have one yet.
+    void insert(const foundation::uint16 mtlid, const foundation::uint32 slot);
+
+    void clear();
+
+    // Return all (material ID, material slot) pairs, in insertion order.
+    const std::vector<Entry>& entries() const;
+
+  private:
+    std::vector<foundation::uint32>     m_dense;            // material slots indexed by material ID
+    std::vector<Entry>                  m_sparse;           // sorted by material ID
+    std::vector<Entry>                  m_entries;
+
+    foundation::uint32 get_sparse_slot(const foundation::uint16 mtlid) const;
+};
+
+// A copy of the geometry of a 3ds Max mesh, laid out like an appleseed mesh object.
+struct MeshSnapshot
+{
+    struct Triangle
+    {
+        foundation::uint32                  m_v0, m_v1, m_v2;   // vertex indices
+        foundation::uint32                  m_n0, m_n1, m_n2;   // vertex normal indices
+        foundation::uint32                  m_a0, m_a1, m_a2;   // texture coordinates indices
+        foundation::uint16                  m_mtlid;            // 3ds Max material ID
+    };
+
+    typedef std::vector<foundation::Vector3f> VertexPose;         // in mesh space
+    typedef std::vector<foundation::Vector3f> NormalPose;         // in mesh space
+
+    foundation::Transformf                  m_transform;        // mesh to object space transform
+    std::vector<foundation::Vector3f>       m_vertices;         // in mesh space
+    std::vector<VertexPose>                 m_vertex_poses;     // vertices at the next motion keys
+    std::vector<foundation::Vector3f>       m_vertex_normals;   // in mesh space, not necessarily unit-length
+    std::vector<NormalPose>                 m_normal_poses;     // vertex normals at the next motion keys
+    std::vector<foundation::Vector2f>       m_tex_coords;
+    std::vector<Triangle>                   m_triangles;
+    size_t                                  m_border_triangle_count;    // trailing triangles dropped after subdivision
+
+    MeshSnapshot();
+
+    // Exchange the contents of two snapshots.
+    void swap(MeshSnapshot& rhs);
+
+    // Release the memory used by this snapshot.
+    void clear();
+};
+
+// Options of the conversion of a mesh snapshot.
+struct MeshConversionParams
+{
+    bool                                    m_weld_vertex_attributes;
+    float                                   m_weld_tolerance;
+    bool                                    m_optimize;
+    int                                     m_subdivision_iterations;
+    std::vector<int>                        m_map_channels;     // 3ds Max map channels used by materials, sorted
+
+    MeshConversionParams();
+
+    bool operator==(const MeshConversionParams& rhs) const;
+    bool operator!=(const MeshConversionParams& rhs) const;
+};
+
+// Statistics collected during the conversion of mesh snapshots.
+struct MeshConversionStats
+{
+    size_t                                  m_triangle_count;
+    size_t                                  m_input_vertex_normal_count;
+    size_t                                  m_output_vertex_normal_count;
+    size_t                                  m_input_tex_coords_count;
+    size_t                                  m_output_tex_coords_count;
+    size_t                                  m_degenerate_triangle_count;
+    size_t                                  m_duplicate_triangle_count;
+    size_t                                  m_unused_vertex_count;
+
+    MeshConversionStats();
+
+    MeshConversionStats& operator+=(const MeshConversionStats& rhs);
+};
+
+// The conversion of a mesh snapshot to an appleseed mesh object.
+struct MeshConversionJob
+{
+    std::string                                         m_name;
+    MeshSnapshot                                        m_snapshot;
+    MeshConversionParams                                m_params;
+    MeshConversionStats                                 m_stats;
+    foundation::uint64                                  m_content_hash;         // hash of the unprocessed snapshot
+    bool                                                m_keep_snapshot;
+    bool                                                m_snapshot_processed;   // snapshot already welded and optimized
+    bool                                                m_convert;              // create the appleseed mesh object
+    MaterialSlotMap                                     m_mtlid_to_slot;
+    foundation::auto_release_ptr<renderer::MeshObject>  m_object;
+
+    MeshConversionJob();
+
+    // Subdivide, weld and optimize the snapshot unless `m_snapshot_processed` is set, convert it
+    // if `m_convert` is set, and release its memory unless `m_keep_snapshot` is set.
+    void execute();
+};
+
+typedef std::vector<std::unique_ptr<MeshConversionJob>> MeshConversionJobs;
+
+// Compute a hash of the geometry of a mesh snapshot: transform, vertices and their poses,
+// vertex normals, texture coordinates, and triangles with their material IDs.
+foundation::uint64 compute_content_hash(const MeshSnapshot& snapshot);
+
+// Combine the content hashes of the jobs of an object and their subdivision iterations.
+foundation::uint64 compute_content_hash(const MeshConversionJobs& jobs);
+
+// Return true if two mesh snapshots hold the same geometry: transform, vertices and their
+// poses, vertex normals, texture coordinates, and triangles with their material IDs.
+bool are_snapshots_identical(const MeshSnapshot& lhs, const MeshSnapshot& rhs);
+
+// Return true if two sets of jobs hold identical snapshots with the same subdivision iterations.
+bool are_snapshots_identical(const MeshConversionJobs& lhs, const MeshConversionJobs& rhs);
+
+// Compute a hash of the geometry and material slots of an appleseed mesh object. The name
+// of the object is not hashed so that renamed objects keep the same hash.
+foundation::uint64 compute_content_hash(const renderer::MeshObject& object);
+
+// Estimate the memory used by the appleseed mesh object converted from a mesh snapshot.
+size_t estimate_mesh_object_size(const MeshSnapshot& snapshot);
+
+// Transform an array of points from mesh space to object space.
+// `input` and `output` may point to the same array.
+void transform_points(
+    const foundation::Transformf&   transform,
+    const foundation::Vector3f*     input,
+    foundation::Vector3f*           output,
+    const size_t                    count);
+
+// Transform an array of normals from mesh space to object space and normalize them.
+// `input` and `output` may point to the same array.
+void transform_normals(
+    const foundation::Transformf&   transform,
+    const foundation::Vector3f*     input,
+    foundation::Vector3f*           output,
+    const size_t                    count);
+
+// Apply a number of iterations of Loop subdivision to a mesh snapshot. Vertex poses follow
+// the vertices; vertex normals, their poses and texture coordinates are interpolated linearly.
+// When the snapshot is a part of a larger mesh, its last `m_border_triangle_count` triangles
+// are the neighbors of the part in the rest of the mesh: they let the edges and vertices at
+// the border of the part be subdivided like interior ones, then they are dropped along with
+// the vertices, vertex normals and texture coordinates only they use.
+void subdivide_mesh_snapshot(
+    MeshSnapshot&                   snapshot,
+    const size_t                    iterations);
+
+// Merge the vertex normals and the texture coordinates of a mesh snapshot that are equal
+// within a given tolerance. A tolerance of zero only merges values that are strictly equal.
+// Vertex normals with poses are not merged.
+void weld_vertex_attributes(
+    MeshSnapshot&                   snapshot,
+    const float                     tolerance);
+
+// Remove degenerate and duplicate triangles as well as unused vertices, vertex normals
+// and texture coordinates, then reorder triangles and vertices for spatial locality.
+void optimize_mesh_snapshot(
+    MeshSnapshot&                   snapshot,
+    MeshConversionStats&            stats);
+
+// Convert a mesh snapshot to an appleseed mesh object with a given name. Vertex and vertex
+// normal poses become the motion segments of the object. The mapping from 3ds Max material IDs to the material
+// slots of the new object is stored in `mtlid_to_slot`.
+foundation::auto_release_ptr<renderer::MeshObject> convert_mesh_snapshot(
+    const MeshSnapshot&             snapshot,
+    const char*                     name,
+    MaterialSlotMap&                mtlid_to_slot);
+
+// Execute a batch of conversion jobs using a given number of threads. The results are
+// stored in the jobs themselves so they do not depend on the order of execution. If a job
+// throws, no further job is started and the exception is rethrown once all threads are done.
+void execute_mesh_conversion_jobs(
+    const std::vector<MeshConversionJob*>&  jobs,
+    const size_t                            thread_count);
+
+
+//
+// MaterialSlotMap class implementation.
+//
+
+inline foundation::uint32 MaterialSlotMap::get_slot(const foundation::uint16 mtlid) const
+{
+    return
+        mtlid < m_dense.size()
+            ? m_dense[mtlid]
+            : get_sparse_slot(mtlid);
+}
+
+inline const std::vector<MaterialSlotMap::Entry>& MaterialSlotMap::entries() const
+{
+    return m_entries;
+}
@@ -33,9 +33,13 @@
 #include "appleseedenvmap/appleseedenvmap.h"
 #include "appleseedobjpropsmod/appleseedobjpropsmod.h"
 #include "appleseedrenderelement/appleseedrenderelement.h"
+#include "appleseedrenderer/geometrycache.h"
+#include "appleseedrenderer/materialcache.h"
 #include "appleseedrenderer/maxsceneentities.h"
+#include "appleseedrenderer/meshconversion.h"
 #include "appleseedrenderer/renderersettings.h"
 #include "iappleseedmtl.h"
+#include "oslutils.h"
 #include "seexprutils.h"
 #include "utilities.h"
 
@@ -48,6 +52,7 @@
 #include "renderer/api/environmentshader.h"
 #include "renderer/api/frame.h"
 #include "renderer/api/light.h"
+#include "renderer/api/log.h"
 #include "renderer/api/material.h"
 #include "renderer/api/object.h"
 #include "renderer/api/project.h"
@@ -63,16 +68,19 @@
 #include "foundation/math/scalar.h"
 #include "foundation/math/transform.h"
 #include "foundation/math/vector.h"
+#include "foundation/platform/system.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/containers/dictionary.h"
 #include "foundation/utility/iostreamop.h"
 #include "foundation/utility/searchpaths.h"
+#include "foundation/utility/string.h"
 
 // 3ds Max headers.
 #include <assert1.h>
 #include <bitmap.h>
 #include <genlight.h>
 #include <iInstanceMgr.h>
+#include <imtl.h>
 #include <INodeTab.h>
 #include <modstack.h>
 #include <object.h>
@@ -82,15 +90,24 @@
 #if MAX_RELEASE >= 18000
 #include <Scene/IPhysicalCamera.h>
 #endif
+#include <shape.h>
+#include <spline3d.h>
+#include <stdmat.h>
 #include <trig.h>
 #include <triobj.h>
 
 // Standard headers.
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
+#include <exception>
 #include <limits>
 #include <map>
+#include <memory>
+#include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -174,48 +191,281 @@ namespace
     struct ObjectInfo
     {
         std::string                     m_name;             // name of the appleseed object
-        std::map<MtlID, asf::uint32>    m_mtlid_to_slot;    // map a 3ds Max's material ID to an appleseed's material slot
+        MaterialSlotMap                 m_mtlid_to_slot;    // map a 3ds Max's material ID to an appleseed's material slot
+        std::vector<std::string>        m_slot_names;       // names of the material slots, if not material_slot_<slot>
     };
 
-    asf::auto_release_ptr<asr::MeshObject> convert_mesh_object(
+    std::string get_material_slot_name(
+        const ObjectInfo&               object_info,
+        const asf::uint32               slot)
+    {
+        return
+            slot < object_info.m_slot_names.size()
+                ? object_info.m_slot_names[slot]
+                : "material_slot_" + asf::to_string(slot);
+    }
+
+    asf::Transformf to_mesh_transform(const Matrix3& input)
+    {
+        // Unlike to_matrix4d(), there is no change of basis here.
+        asf::Matrix4f m;
+        for (int row = 0; row < 3; ++row)
+        {
+            for (int col = 0; col < 3; ++col)
+                m(row, col) = input[col][row];
+            m(row, 3) = input[3][row];
+        }
+        m(3, 0) = 0.0f;
+        m(3, 1) = 0.0f;
+        m(3, 2) = 0.0f;
+        m(3, 3) = 1.0f;
+
+        return asf::Transformf::from_local_to_parent(m);
+    }
+
+    // Map the vertex indices of a 3ds Max mesh to the vertex indices of a snapshot
+    // holding a subset of its faces. Vertices are numbered by order of first use.
+    class ChunkIndexMap
+    {
+      public:
+        explicit ChunkIndexMap(const size_t size)
+          : m_remap(size, static_cast<asf::uint32>(Unused))
+        {
+        }
+
+        // Return true if `index` is used for the first time by the current chunk.
+        bool map(const DWORD index, asf::uint32& chunk_index)
+        {
+            asf::uint32& entry = m_remap[index];
+            const bool first_use = entry == Unused;
+
+            if (first_use)
+            {
+                entry = static_cast<asf::uint32>(m_used.size());
+                m_used.push_back(index);
+            }
+
+            chunk_index = entry;
+            return first_use;
+        }
+
+        // Forget the indices used by the current chunk, in time proportional to their number.
+        void reset()
+        {
+            for (const auto index : m_used)
+                m_remap[index] = Unused;
+
+            m_used.clear();
+        }
+
+      private:
+        static const asf::uint32 Unused = ~asf::uint32(0);
+
+        std::vector<asf::uint32>    m_remap;
+        std::vector<DWORD>          m_used;
+    };
+
+    void collect_map_channels(MtlBase* mtl_base, std::vector<int>& map_channels)
+    {
+        if (IsTex(mtl_base))
+        {
+            Texmap* texmap = static_cast<Texmap*>(mtl_base);
+            UVGen* uv_gen = texmap->GetTheUVGen();
+
+            // Texmaps without UV generator are rendered to bitmaps mapped with the first map channel.
+            int map_channel = 1;
+            if (uv_gen != nullptr && uv_gen->IsStdUVGen())
+            {
+                map_channel =
+                    static_cast<StdUVGen*>(uv_gen)->GetUVWSource() == UVWSRC_EXPLICIT
+                        ? texmap->GetMapChannel()
+                        : 0;
+            }
+
+            // Vertex colors (map channel 0) and generated coordinates can't be stored in texture coordinates.
+            if (map_channel > 0)
+                map_channels.push_back(map_channel);
+        }
+
+        if (IsMtl(mtl_base))
+        {
+            Mtl* mtl = static_cast<Mtl*>(mtl_base);
+            for (int i = 0, e = mtl->NumSubMtls(); i < e; ++i)
+            {
+                Mtl* submtl = mtl->GetSubMtl(i);
+                if (submtl != nullptr)
+                    collect_map_channels(submtl, map_channels);
+            }
+        }
+
+        for (int i = 0, e = mtl_base->NumSubTexmaps(); i < e; ++i)
+        {
+            Texmap* sub_texmap = mtl_base->GetSubTexmap(i);
+            if (sub_texmap != nullptr)
+                collect_map_channels(sub_texmap, map_channels);
+        }
+    }
+
+    // Return the map channels used by the materials of a set of nodes, in increasing order.
+    std::vector<int> get_map_channels(const std::vector<INode*>& nodes)
+    {
+        std::vector<int> map_channels;
+
+        for (const auto node : nodes)
+        {
+            Mtl* mtl = node->GetMtl();
+            if (mtl != nullptr)
+                collect_map_channels(mtl, map_channels);
+        }
+
+        std::sort(map_channels.begin(), map_channels.end());
+        map_channels.erase(std::unique(map_channels.begin(), map_channels.end()), map_channels.end());
+
+        return map_channels;
+    }
+
+    // The map channel of a 3ds Max mesh that provides the texture coordinates of a snapshot.
+    struct MapChannelSource
+    {
+        int                     m_channel;
+        const UVVert*           m_verts;            // nullptr if there are no texture coordinates
+        const TVFace*           m_faces;
+        int                     m_vert_count;
+
+        MapChannelSource()
+          : m_channel(0)
+          , m_verts(nullptr)
+          , m_faces(nullptr)
+          , m_vert_count(0)
+        {
+        }
+
+        MapChannelSource(Mesh& mesh, const int channel)
+          : m_channel(channel)
+          , m_verts(mesh.mapVerts(channel))
+          , m_faces(mesh.mapFaces(channel))
+          , m_vert_count(mesh.getNumMapVerts(channel))
+        {
+        }
+    };
+
+    bool is_map_channel_used(Mesh& mesh, const int channel)
+    {
+        return
+            mesh.mapSupport(channel) &&
+            mesh.getNumMapVerts(channel) > 0 &&
+            mesh.mapFaces(channel) != nullptr;
+    }
+
+    bool are_map_channels_identical(Mesh& mesh, const int channel1, const int channel2)
+    {
+        const int vert_count = mesh.getNumMapVerts(channel1);
+        return
+            mesh.getNumMapVerts(channel2) == vert_count &&
+            std::memcmp(mesh.mapVerts(channel1), mesh.mapVerts(channel2), vert_count * sizeof(UVVert)) == 0 &&
+            std::memcmp(mesh.mapFaces(channel1), mesh.mapFaces(channel2), mesh.getNumFaces() * sizeof(TVFace)) == 0;
+    }
+
+    // appleseed mesh objects have a single set of texture coordinates. Select the first map
+    // channel used by materials that the mesh provides, and warn if materials use other
+    // channels whose content differs. The first map channel is kept by default since
+    // procedural shaders and materials assigned later may use it without any texmap.
+    MapChannelSource select_map_channel(
+        INode*                  object_node,
+        Mesh&                   mesh,
+        const std::vector<int>& map_channels)
+    {
+        MapChannelSource source;
+        bool found = false;
+        std::vector<int> ignored_channels;
+
+        for (const int channel : map_channels)
+        {
+            if (!is_map_channel_used(mesh, channel))
+                continue;
+
+            if (!found)
+            {
+                source = MapChannelSource(mesh, channel);
+                found = true;
+            }
+            else if (!are_map_channels_identical(mesh, source.m_channel, channel))
+                ignored_channels.push_back(channel);
+        }
+
+        if (!found && is_map_channel_used(mesh, 1))
+            source = MapChannelSource(mesh, 1);
+
+        for (const int channel : ignored_channels)
+        {
+            RENDERER_LOG_WARNING(
+                "object \"%s\": map channel %d is used by materials but only map channel %d is exported.",
+                wide_to_utf8(object_node->GetName()).c_str(),
+                channel,
+                source.m_channel);
+        }
+
+        return source;
+    }
+
+    // Copy the faces [face_begin, face_end) of a 3ds Max mesh to a mesh snapshot, followed by
+    // the faces in `border_faces` as border triangles. When the snapshot does not hold all
+    // faces, `vertex_map` and `tex_vertex_map` are used to only copy the vertices and texture
+    // vertices of these faces. When `pose_only` is set, only vertices and vertex normals are
+    // copied, in the same order as for a full snapshot.
+    void take_mesh_snapshot(
         Mesh&                   mesh,
         const Matrix3&          mesh_transform,
-        ObjectInfo&             object_info)
+        const MapChannelSource& map_channel,
+        const int               face_begin,
+        const int               face_end,
+        const std::vector<int>& border_faces,
+        ChunkIndexMap*          vertex_map,
+        ChunkIndexMap*          tex_vertex_map,
+        const bool              pose_only,
+        MeshSnapshot&           snapshot)
     {
-        asf::auto_release_ptr<asr::MeshObject> object(
-            asr::MeshObjectFactory().create(object_info.m_name.c_str(), asr::ParamArray()));
+        static_assert(
+            sizeof(MtlID) == sizeof(asf::uint16),
+            "MtlID is expected to be 16-bit long");
+
+        snapshot.m_transform = to_mesh_transform(mesh_transform);
 
         // Make sure the input mesh has vertex normals.
         mesh.checkNormals(TRUE);
 
-        // Copy vertices to the mesh object.
-        object->reserve_vertices(mesh.getNumVerts());
-        for (int i = 0, e = mesh.getNumVerts(); i < e; ++i)
+        const bool whole_mesh = face_begin == 0 && face_end == mesh.getNumFaces() && border_faces.empty();
+        DbgAssert(whole_mesh || (vertex_map != nullptr && tex_vertex_map != nullptr));
+
+        if (whole_mesh)
         {
-            const Point3 v = mesh_transform * mesh.getVert(i);
-            object->push_vertex(asr::GVector3(v.x, v.y, v.z));
+            // Copy vertices.
+            snapshot.m_vertices.reserve(mesh.getNumVerts());
+            for (int i = 0, e = mesh.getNumVerts(); i < e; ++i)
+                snapshot.m_vertices.push_back(to_vector3f(mesh.getVert(i)));
+
+            // Copy texture vertices.
+            snapshot.m_tex_coords.reserve(map_channel.m_vert_count);
+            for (int i = 0; i < map_channel.m_vert_count; ++i)
+            {
+                const UVVert& uv = map_channel.m_verts[i];
+                snapshot.m_tex_coords.push_back(asf::Vector2f(uv.x, uv.y));
+            }
         }
 
-        // Copy texture vertices to the mesh object.
-        object->reserve_tex_coords(mesh.getNumTVerts());
-        for (int i = 0, e = mesh.getNumTVerts(); i < e; ++i)
+        // Copy vertex normals and triangles.
+        const int face_count = face_end - face_begin;
+        const int total_face_count = face_count + static_cast<int>(border_faces.size());
+        snapshot.m_vertex_normals.reserve(total_face_count * 3);
+        if (!pose_only)
         {
-            const UVVert& uv = mesh.getTVert(i);
-            object->push_tex_coords(asr::GVector2(uv.x, uv.y));
+            snapshot.m_triangles.reserve(total_face_count);
+            snapshot.m_border_triangle_count = border_faces.size();
         }
-
-        // Compute the matrix to transform normals.
-        Matrix3 normal_transform = mesh_transform;
-        normal_transform.Invert();
-        normal_transform = transpose(normal_transform);
-
-        // Copy vertex normals and triangles to mesh object.
-        object->reserve_vertex_normals(mesh.getNumFaces() * 3);
-        object->reserve_triangles(mesh.getNumFaces());
-        for (int i = 0, e = mesh.getNumFaces(); i < e; ++i)
+        for (int f = 0; f < total_face_count; ++f)
         {
+            const int i = f < face_count ? face_begin + f : border_faces[f - face_count];
             Face& face = mesh.faces[i];
-            TVFace& tvface = mesh.tvFace[i];
 
             const DWORD face_smgroup = face.getSmGroup();
             const MtlID face_mat = face.getMatID();
@@ -224,11 +474,8 @@ namespace
             if (face_smgroup == 0)
             {
                 // No smooth group for this face, use the face normal.
-                const Point3 n = normal_transform * mesh.getFaceNormal(i);
-                const asf::uint32 normal_index =
-                    static_cast<asf::uint32>(
-                        object->push_vertex_normal(
-                            asf::safe_normalize(asr::GVector3(n.x, n.y, n.z))));
+                const asf::uint32 normal_index = static_cast<asf::uint32>(snapshot.m_vertex_normals.size());
+                snapshot.m_vertex_normals.push_back(to_vector3f(mesh.getFaceNormal(i)));
                 normal_indices[0] = normal_index;
                 normal_indices[1] = normal_index;
                 normal_indices[2] = normal_index;
@@ -242,29 +489,31 @@ namespace
                     if (normal_count == 1)
                     {
                         // This vertex has a single normal.
-                        const Point3& n = rvertex.rn.getNormal();
-                        normal_indices[j] =
-                            static_cast<asf::uint32>(
-                                object->push_vertex_normal(
-                                    asf::safe_normalize(asr::GVector3(n.x, n.y, n.z))));
+                        normal_indices[j] = static_cast<asf::uint32>(snapshot.m_vertex_normals.size());
+                        snapshot.m_vertex_normals.push_back(to_vector3f(rvertex.rn.getNormal()));
                     }
                     else
                     {
                         // This vertex has multiple normals.
-                        for (size_t k = 0; k < normal_count; ++k)
+                        size_t k = 0;
+                        for (; k < normal_count; ++k)
                         {
                             // Find the normal for this smooth group and material.
                             RNormal& rn = rvertex.ern[k];
                             if ((face_smgroup & rn.getSmGroup()) && face_mat == rn.getMtlIndex())
                             {
-                                const Point3& n = rn.getNormal();
-                                normal_indices[j] =
-                                    static_cast<asf::uint32>(
-                                        object->push_vertex_normal(
-                                            asf::safe_normalize(asr::GVector3(n.x, n.y, n.z))));
+                                normal_indices[j] = static_cast<asf::uint32>(snapshot.m_vertex_normals.size());
+                                snapshot.m_vertex_normals.push_back(to_vector3f(rn.getNormal()));
                                 break;
                             }
                         }
+
+                        // No normal matches this face, use the face normal.
+                        if (k == normal_count)
+                        {
+                            normal_indices[j] = static_cast<asf::uint32>(snapshot.m_vertex_normals.size());
+                            snapshot.m_vertex_normals.push_back(to_vector3f(mesh.getFaceNormal(i)));
+                        }
                     }
                 }
             }
@@ -273,115 +522,803 @@ namespace
                 sizeof(DWORD) == sizeof(asf::uint32),
                 "DWORD is expected to be 32-bit long");
 
-            asr::Triangle triangle;
-            triangle.m_v0 = face.getVert(0);
-            triangle.m_v1 = face.getVert(1);
-            triangle.m_v2 = face.getVert(2);
-            triangle.m_n0 = normal_indices[0];
-            triangle.m_n1 = normal_indices[1];
-            triangle.m_n2 = normal_indices[2];
-            if (mesh.getNumTVerts() > 0)
+            if (pose_only)
+            {
+                if (!whole_mesh)
+                {
+                    asf::uint32 vertex_index;
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        if (vertex_map->map(face.getVert(j), vertex_index))
+                            snapshot.m_vertices.push_back(to_vector3f(mesh.getVert(face.getVert(j))));
+                    }
+                }
+                continue;
+            }
+
+            asf::uint32 vertex_indices[3];
+            asf::uint32 tex_vertex_indices[3];
+            for (int j = 0; j < 3; ++j)
+            {
+                if (whole_mesh)
+                {
+                    vertex_indices[j] = face.getVert(j);
+                    if (map_channel.m_verts != nullptr)
+                        tex_vertex_indices[j] = map_channel.m_faces[i].getTVert(j);
+                }
+                else
+                {
+                    if (vertex_map->map(face.getVert(j), vertex_indices[j]))
+                        snapshot.m_vertices.push_back(to_vector3f(mesh.getVert(face.getVert(j))));
+
+                    if (map_channel.m_verts != nullptr &&
+                        tex_vertex_map->map(map_channel.m_faces[i].getTVert(j), tex_vertex_indices[j]))
+                    {
+                        const UVVert& uv = map_channel.m_verts[map_channel.m_faces[i].getTVert(j)];
+                        snapshot.m_tex_coords.push_back(asf::Vector2f(uv.x, uv.y));
+                    }
+                }
+            }
+
+            MeshSnapshot::Triangle triangle;
+            triangle.m_v0 = vertex_indices[0];
+            triangle.m_v1 = vertex_indices[1];
+            triangle.m_v2 = vertex_indices[2];
+            triangle.m_n0 = normal_indices[0];
+            triangle.m_n1 = normal_indices[1];
+            triangle.m_n2 = normal_indices[2];
+            if (map_channel.m_verts != nullptr)
+            {
+                triangle.m_a0 = tex_vertex_indices[0];
+                triangle.m_a1 = tex_vertex_indices[1];
+                triangle.m_a2 = tex_vertex_indices[2];
+            }
+            else
+            {
+                triangle.m_a0 = asr::Triangle::None;
+                triangle.m_a1 = asr::Triangle::None;
+                triangle.m_a2 = asr::Triangle::None;
+            }
+            triangle.m_mtlid = face_mat;
+
+            snapshot.m_triangles.push_back(triangle);
+        }
+    }
+
+    typedef std::map<Object*, MeshConversionJobs> MeshConversionJobMap;
+
+    // Meshes with more faces than this are split into several objects. Each part is converted
+    // by its own job and its snapshot is released as soon as it is converted, instead of the
+    // snapshot of the whole mesh coexisting with the whole appleseed mesh.
+    const int MaxChunkFaceCount = 1024 * 1024;
+
+    // The faces around each vertex of a 3ds Max mesh.
+    class VertexFaces
+    {
+      public:
+        explicit VertexFaces(Mesh& mesh)
+          : m_offsets(mesh.getNumVerts() + 1, 0)
+          , m_faces(mesh.getNumFaces() * 3)
+        {
+            const int face_count = mesh.getNumFaces();
+
+            for (int i = 0; i < face_count; ++i)
+            {
+                for (int j = 0; j < 3; ++j)
+                    ++m_offsets[mesh.faces[i].getVert(j) + 1];
+            }
+
+            for (size_t v = 1, e = m_offsets.size(); v < e; ++v)
+                m_offsets[v] += m_offsets[v - 1];
+
+            std::vector<size_t> ends(m_offsets.begin(), m_offsets.end() - 1);
+            for (int i = 0; i < face_count; ++i)
+            {
+                for (int j = 0; j < 3; ++j)
+                    m_faces[ends[mesh.faces[i].getVert(j)]++] = i;
+            }
+        }
+
+        // Collect the faces outside [face_begin, face_end) sharing a vertex with a face of this range.
+        void collect_border_faces(
+            Mesh&               mesh,
+            const int           face_begin,
+            const int           face_end,
+            std::vector<int>&   border_faces) const
+        {
+            border_faces.clear();
+
+            std::vector<bool> visited_vertices(m_offsets.size() - 1, false);
+            std::vector<bool> visited_faces(m_faces.size() / 3, false);
+
+            for (int i = face_begin; i < face_end; ++i)
+            {
+                for (int j = 0; j < 3; ++j)
+                {
+                    const DWORD v = mesh.faces[i].getVert(j);
+                    if (visited_vertices[v])
+                        continue;
+
+                    visited_vertices[v] = true;
+
+                    for (size_t k = m_offsets[v], e = m_offsets[v + 1]; k < e; ++k)
+                    {
+                        const int face = m_faces[k];
+                        if ((face < face_begin || face >= face_end) && !visited_faces[face])
+                        {
+                            visited_faces[face] = true;
+                            border_faces.push_back(face);
+                        }
+                    }
+                }
+            }
+
+            std::sort(border_faces.begin(), border_faces.end());
+        }
+
+      private:
+        std::vector<size_t>     m_offsets;          // index of the first face of each vertex in m_faces
+        std::vector<int>        m_faces;
+    };
+
+    // When `pose_only` is set, only vertices and vertex normals are copied to the snapshots.
+    // When a split mesh is subdivided, the faces around each part are copied along with it
+    // so that the subdivision of the part matches that of the whole mesh along its borders.
+    // Return the number of parts the mesh was split into, or 0 if it was not split.
+    size_t add_mesh_conversion_jobs(
+        INode*                          object_node,
+        Mesh&                           mesh,
+        const Matrix3&                  mesh_transform,
+        const MeshConversionParams&     params,
+        const bool                      pose_only,
+        MeshConversionJobs&             jobs)
+    {
+        const int face_count = mesh.getNumFaces();
+        const bool split = face_count > MaxChunkFaceCount;
+
+        // Only copy texture coordinates if materials use them.
+        const MapChannelSource map_channel =
+            pose_only
+                ? MapChannelSource()
+                : select_map_channel(object_node, mesh, params.m_map_channels);
+
+        std::unique_ptr<ChunkIndexMap> vertex_map;
+        std::unique_ptr<ChunkIndexMap> tex_vertex_map;
+        if (split)
+        {
+            vertex_map.reset(new ChunkIndexMap(mesh.getNumVerts()));
+            tex_vertex_map.reset(new ChunkIndexMap(map_channel.m_vert_count));
+        }
+
+        std::unique_ptr<VertexFaces> vertex_faces;
+        if (split && params.m_subdivision_iterations > 0)
+            vertex_faces.reset(new VertexFaces(mesh));
+
+        std::vector<int> border_faces;
+
+        int begin = 0;
+        do
+        {
+            const int end = split ? std::min(begin + MaxChunkFaceCount, face_count) : face_count;
+
+            if (vertex_faces)
+                vertex_faces->collect_border_faces(mesh, begin, end, border_faces);
+
+            std::unique_ptr<MeshConversionJob> job(new MeshConversionJob());
+            job->m_name = wide_to_utf8(object_node->GetName());
+            job->m_params = params;
+            take_mesh_snapshot(mesh, mesh_transform, map_channel, begin, end, border_faces, vertex_map.get(), tex_vertex_map.get(), pose_only, job->m_snapshot);
+            if (!pose_only)
+                job->m_content_hash = compute_content_hash(job->m_snapshot);
+            jobs.push_back(std::move(job));
+
+            if (split)
+            {
+                vertex_map->reset();
+                tex_vertex_map->reset();
+            }
+
+            begin = end;
+        } while (begin < face_count);
+
+        return split ? static_cast<size_t>((face_count + MaxChunkFaceCount - 1) / MaxChunkFaceCount) : 0;
+    }
+
+    // Snapshot the render meshes of a node, one conversion job per 3ds Max mesh or mesh part.
+    // Return the interval over which the snapshots are valid. When `pose_only` is set, only
+    // vertices and vertex normals are copied to the snapshots. The number of parts of split
+    // meshes is added to `split_part_count` if it is not null.
+    Interval take_mesh_snapshots(
+        INode*                          object_node,
+        const ObjectState&              object_state,
+        const TimeValue                 time,
+        const MeshConversionParams&     params,
+        MeshConversionJobs&             jobs,
+        const bool                      pose_only = false,
+        size_t*                         split_part_count = nullptr)
+    {
+        GeomObject* geom_object = static_cast<GeomObject*>(object_state.obj);
+        Interval validity = geom_object->ObjectValidity(time);
+        size_t part_count = 0;
+
+        const int render_mesh_count = geom_object->NumberOfRenderMeshes();
+        if (render_mesh_count > 0)
+        {
+            for (int i = 0; i < render_mesh_count; ++i)
+            {
+                NullView view;
+                BOOL need_delete;
+                Mesh* mesh = geom_object->GetMultipleRenderMesh(time, object_node, view, need_delete, i);
+                if (mesh != nullptr)
+                {
+                    Matrix3 mesh_transform;
+                    Interval mesh_transform_validity(FOREVER);
+                    geom_object->GetMultipleRenderMeshTM(time, object_node, view, i, mesh_transform, mesh_transform_validity);
+                    validity &= mesh_transform_validity;
+
+                    part_count += add_mesh_conversion_jobs(object_node, *mesh, mesh_transform, params, pose_only, jobs);
+
+                    if (need_delete)
+                        mesh->DeleteThis();
+                }
+            }
+        }
+        else
+        {
+            NullView view;
+            BOOL need_delete;
+            Mesh* mesh = geom_object->GetRenderMesh(time, object_node, view, need_delete);
+            if (mesh != nullptr)
+            {
+                part_count += add_mesh_conversion_jobs(object_node, *mesh, Matrix3(TRUE), params, pose_only, jobs);
+
+                if (need_delete)
+                    mesh->DeleteThis();
+            }
+        }
+
+        if (split_part_count != nullptr)
+            *split_part_count += part_count;
+
+        return validity;
+    }
+
+    // Times at which moving objects and the camera are sampled. The shutter opens at the render
+    // time and stays open for a given number of frames; appleseed sees it as the interval [0, 1].
+    struct MotionSampling
+    {
+        std::vector<TimeValue>          m_times;            // 3ds Max time of each motion key
+        std::vector<double>             m_key_times;        // appleseed time of each motion key
+        bool                            m_deformation;      // also sample the vertices of deforming meshes
+
+        MotionSampling(const RendererSettings& settings, const TimeValue time)
+          : m_deformation(false)
+        {
+            size_t key_count = 1;
+            if (settings.m_motion_blur)
+            {
+                key_count = static_cast<size_t>(std::max(settings.m_motion_samples, 2));
+                m_deformation = settings.m_deformation_blur;
+            }
+
+            const double shutter_ticks = static_cast<double>(settings.m_shutter_duration) * GetTicksPerFrame();
+            for (size_t i = 0; i < key_count; ++i)
+            {
+                const double key_time = key_count > 1 ? static_cast<double>(i) / (key_count - 1) : 0.0;
+                m_key_times.push_back(key_time);
+                m_times.push_back(time + static_cast<TimeValue>(key_time * shutter_ticks + 0.5));
+            }
+        }
+
+        bool is_enabled() const
+        {
+            return m_times.size() > 1;
+        }
+
+        Interval get_shutter_interval() const
+        {
+            return Interval(m_times.front(), m_times.back());
+        }
+    };
+
+    // Return the object transform of a node at each motion key, or a single transform if it does not move.
+    std::vector<Matrix3> sample_object_transforms(
+        INode*                          node,
+        const MotionSampling&           motion)
+    {
+        std::vector<Matrix3> transforms;
+        transforms.reserve(motion.m_times.size());
+
+        bool moving = false;
+        for (const auto t : motion.m_times)
+        {
+            transforms.push_back(node->GetObjTMAfterWSM(t));
+            if (!transforms.back().Equals(transforms.front()))
+                moving = true;
+        }
+
+        if (!moving)
+            transforms.resize(1);
+
+        return transforms;
+    }
+
+    void set_transform_keys(
+        asr::TransformSequence&         transform_sequence,
+        const std::vector<Matrix3>&     transforms,
+        const MotionSampling&           motion)
+    {
+        for (size_t i = 0, e = transforms.size(); i < e; ++i)
+        {
+            transform_sequence.set_transform(
+                motion.m_key_times[i],
+                asf::Transformd::from_local_to_parent(to_matrix4d(transforms[i])));
+        }
+    }
+
+    // World states of the renderable object instances at render time. They are evaluated once
+    // during entity collection. Evaluating a node at another time invalidates the states of
+    // all the nodes referencing the same object, which are then evaluated again on request.
+    class ObjectStateCache
+    {
+      public:
+        ObjectStateCache(
+            const MaxSceneEntities&     entities,
+            const TimeValue             time)
+          : m_time(time)
+          , m_nodes(entities.m_objects)
+          , m_states(entities.m_object_states)
+          , m_valid(entities.m_objects.size(), true)
+        {
+            for (size_t i = 0, e = m_nodes.size(); i < e; ++i)
+            {
+                m_node_indices.insert(std::make_pair(m_nodes[i], i));
+                m_object_indices[m_nodes[i]->GetObjectRef()].push_back(i);
+            }
+        }
+
+        // Return the world state of the i'th renderable object instance.
+        const ObjectState& get(const size_t object_index)
+        {
+            if (!m_valid[object_index])
+            {
+                m_states[object_index] = m_nodes[object_index]->EvalWorldState(m_time);
+                m_valid[object_index] = true;
+            }
+
+            return m_states[object_index];
+        }
+
+        const ObjectState& get(INode* node)
+        {
+            const auto it = m_node_indices.find(node);
+            DbgAssert(it != m_node_indices.end());
+            return get(it->second);
+        }
+
+        // Call this after evaluating a node at another time than the render time.
+        void invalidate(INode* node)
+        {
+            const auto it = m_object_indices.find(node->GetObjectRef());
+            if (it != m_object_indices.end())
+            {
+                for (const auto object_index : it->second)
+                    m_valid[object_index] = false;
+            }
+        }
+
+      private:
+        const TimeValue                         m_time;
+        const std::vector<INode*>&              m_nodes;
+        std::vector<ObjectState>                m_states;
+        std::vector<bool>                       m_valid;
+        std::map<INode*, size_t>                m_node_indices;
+        std::map<Object*, std::vector<size_t>>  m_object_indices;
+    };
+
+    // Add to the snapshots of a deforming object a vertex and vertex normal pose per motion key
+    // after the first. No pose is added if the topology of the object changes while the shutter
+    // is open, in which case false is returned.
+    bool take_deformation_snapshots(
+        INode*                          object_node,
+        const MotionSampling&           motion,
+        const MeshConversionParams&     params,
+        ObjectStateCache&               object_states,
+        MeshConversionJobs&             jobs)
+    {
+        bool success = true;
+
+        for (size_t k = 1, e = motion.m_times.size(); k < e; ++k)
+        {
+            const TimeValue key_time = motion.m_times[k];
+
+            // Only vertices and vertex normals are taken at the next motion keys.
+            MeshConversionJobs key_jobs;
+            take_mesh_snapshots(
+                object_node,
+                object_node->EvalWorldState(key_time),
+                key_time,
+                params,
+                key_jobs,
+                true);
+
+            success = key_jobs.size() == jobs.size();
+            for (size_t i = 0, job_count = jobs.size(); success && i < job_count; ++i)
+            {
+                success =
+                    key_jobs[i]->m_snapshot.m_vertices.size() == jobs[i]->m_snapshot.m_vertices.size() &&
+                    key_jobs[i]->m_snapshot.m_vertex_normals.size() == jobs[i]->m_snapshot.m_vertex_normals.size();
+            }
+
+            if (!success)
+                break;
+
+            for (size_t i = 0, job_count = jobs.size(); i < job_count; ++i)
+            {
+                MeshSnapshot& snapshot = jobs[i]->m_snapshot;
+                MeshSnapshot& key_snapshot = key_jobs[i]->m_snapshot;
+
+                // Express the pose in the mesh space of the first motion key.
+                if (key_snapshot.m_transform.get_local_to_parent() != snapshot.m_transform.get_local_to_parent())
+                {
+                    const asf::Transformf to_mesh_space =
+                        asf::Transformf::from_local_to_parent(
+                            snapshot.m_transform.get_parent_to_local() *
+                            key_snapshot.m_transform.get_local_to_parent());
+
+                    if (!key_snapshot.m_vertices.empty())
+                    {
+                        transform_points(
+                            to_mesh_space,
+                            &key_snapshot.m_vertices[0],
+                            &key_snapshot.m_vertices[0],
+                            key_snapshot.m_vertices.size());
+                    }
+
+                    if (!key_snapshot.m_vertex_normals.empty())
+                    {
+                        transform_normals(
+                            to_mesh_space,
+                            &key_snapshot.m_vertex_normals[0],
+                            &key_snapshot.m_vertex_normals[0],
+                            key_snapshot.m_vertex_normals.size());
+                    }
+                }
+
+                snapshot.m_vertex_poses.push_back(MeshSnapshot::VertexPose());
+                snapshot.m_vertex_poses.back().swap(key_snapshot.m_vertices);
+
+                snapshot.m_normal_poses.push_back(MeshSnapshot::NormalPose());
+                snapshot.m_normal_poses.back().swap(key_snapshot.m_vertex_normals);
+            }
+        }
+
+        for (auto& job : jobs)
+        {
+            if (!success)
+            {
+                job->m_snapshot.m_vertex_poses.clear();
+                job->m_snapshot.m_normal_poses.clear();
+            }
+
+            job->m_content_hash = compute_content_hash(job->m_snapshot);
+        }
+
+        // Evaluate the object again at the render time since other nodes may reference it.
+        object_node->EvalWorldState(motion.m_times.front());
+        object_states.invalidate(object_node);
+
+        return success;
+    }
+
+    // Unique shapes and particles of a particle system. The jobs of shape i of a particle system
+    // are the jobs of the system from m_shape_first_jobs[i] to the first job of the next shape.
+    struct ParticleSystem
+    {
+        struct Particle
+        {
+            size_t      m_shape;
+            Matrix3     m_transform;
+        };
+
+        std::vector<size_t>     m_shape_first_jobs;
+        std::vector<Particle>   m_particles;
+    };
+
+    typedef std::map<Object*, ParticleSystem> ParticleSystemMap;
+
+    // Return true if the particles of a particle system can be exported as instances of shapes.
+    bool has_particle_shapes(const ObjectState& object_state)
+    {
+        return
+            is_particle_system(object_state.obj) &&
+            static_cast<GeomObject*>(object_state.obj)->NumberOfRenderMeshes() > 0;
+    }
+
+    // Return true if the jobs [first_job, end_job) of `jobs` hold the same snapshots as `shape_jobs`.
+    bool is_shape_identical(
+        const MeshConversionJobs&       jobs,
+        const size_t                    first_job,
+        const size_t                    end_job,
+        const MeshConversionJobs&       shape_jobs)
+    {
+        if (end_job - first_job != shape_jobs.size())
+            return false;
+
+        for (size_t i = 0, e = shape_jobs.size(); i < e; ++i)
+        {
+            if (!are_snapshots_identical(jobs[first_job + i]->m_snapshot, shape_jobs[i]->m_snapshot))
+                return false;
+        }
+
+        return true;
+    }
+
+    // Snapshot each unique shape of a particle system once, and record the shape and the
+    // transform of each particle. Return the interval over which the snapshots are valid.
+    Interval take_particle_snapshots(
+        INode*                          object_node,
+        const ObjectState&              object_state,
+        const TimeValue                 time,
+        const MeshConversionParams&     params,
+        MeshConversionJobs&             jobs,
+        ParticleSystem&                 particle_system)
+    {
+        GeomObject* geom_object = static_cast<GeomObject*>(object_state.obj);
+        Interval validity = geom_object->ObjectValidity(time);
+
+        // Shapes are identified by content: particle systems may hand out a new mesh per
+        // particle, or reuse the same mesh for different shapes.
+        std::multimap<asf::uint64, size_t> shapes;
+
+        for (int i = 0, e = geom_object->NumberOfRenderMeshes(); i < e; ++i)
+        {
+            NullView view;
+            BOOL need_delete;
+            Mesh* mesh = geom_object->GetMultipleRenderMesh(time, object_node, view, need_delete, i);
+            if (mesh == nullptr)
+                continue;
+
+            ParticleSystem::Particle particle;
+            Interval particle_transform_validity(FOREVER);
+            geom_object->GetMultipleRenderMeshTM(time, object_node, view, i, particle.m_transform, particle_transform_validity);
+            validity &= particle_transform_validity;
+
+            MeshConversionJobs shape_jobs;
+            add_mesh_conversion_jobs(object_node, *mesh, Matrix3(TRUE), params, false, shape_jobs);
+
+            if (need_delete)
+                mesh->DeleteThis();
+
+            // Matching hashes are confirmed by comparing the snapshots.
+            const asf::uint64 content_hash = compute_content_hash(shape_jobs);
+            const auto range = shapes.equal_range(content_hash);
+            auto it = range.first;
+            for (; it != range.second; ++it)
             {
-                triangle.m_a0 = tvface.getTVert(0);
-                triangle.m_a1 = tvface.getTVert(1);
-                triangle.m_a2 = tvface.getTVert(2);
+                const std::vector<size_t>& first_jobs = particle_system.m_shape_first_jobs;
+                const size_t end_job = it->second + 1 < first_jobs.size() ? first_jobs[it->second + 1] : jobs.size();
+                if (is_shape_identical(jobs, first_jobs[it->second], end_job, shape_jobs))
+                    break;
             }
+
+            if (it != range.second)
+                particle.m_shape = it->second;
             else
             {
-                triangle.m_a0 = asr::Triangle::None;
-                triangle.m_a1 = asr::Triangle::None;
-                triangle.m_a2 = asr::Triangle::None;
+                particle.m_shape = particle_system.m_shape_first_jobs.size();
+                particle_system.m_shape_first_jobs.push_back(jobs.size());
+                shapes.insert(std::make_pair(content_hash, particle.m_shape));
+
+                for (auto& job : shape_jobs)
+                    jobs.push_back(std::move(job));
             }
 
-            // Assign to the triangle the material slot corresponding to the face's material ID,
-            // creating a new material slot if necessary.
-            asf::uint32 slot;
-            const MtlID mtlid = face.getMatID();
-            const auto it = object_info.m_mtlid_to_slot.find(mtlid);
-            if (it == object_info.m_mtlid_to_slot.end())
+            particle_system.m_particles.push_back(particle);
+        }
+
+        return validity;
+    }
+
+    // Insert the mesh objects produced by a set of executed jobs into an assembly.
+    std::vector<ObjectInfo> insert_mesh_objects(
+        asr::Assembly&          assembly,
+        MeshConversionJobs&     jobs)
+    {
+        std::vector<ObjectInfo> object_infos;
+
+        for (auto& job : jobs)
+        {
+            ObjectInfo object_info;
+            object_info.m_name = make_unique_name(assembly.objects(), job->m_name);
+            object_info.m_mtlid_to_slot = job->m_mtlid_to_slot;
+
+            if (object_info.m_name != job->m_name)
+                job->m_object->set_name(object_info.m_name.c_str());
+
+            assembly.objects().insert(asf::auto_release_ptr<asr::Object>(job->m_object));
+
+            if (job->m_params.m_optimize)
             {
-                // Create a new material slot in the object.
-                const auto slot_name = "material_slot_" + asf::to_string(object->get_material_slot_count());
-                slot = static_cast<asf::uint32>(object->push_material_slot(slot_name.c_str()));
-                object_info.m_mtlid_to_slot.insert(std::make_pair(mtlid, slot));
+                RENDERER_LOG_DEBUG(
+                    "optimized object \"%s\": removed %s degenerate and %s duplicate %s, and %s unused %s.",
+                    object_info.m_name.c_str(),
+                    asf::pretty_uint(job->m_stats.m_degenerate_triangle_count).c_str(),
+                    asf::pretty_uint(job->m_stats.m_duplicate_triangle_count).c_str(),
+                    asf::plural(job->m_stats.m_duplicate_triangle_count, "triangle").c_str(),
+                    asf::pretty_uint(job->m_stats.m_unused_vertex_count).c_str(),
+                    asf::plural(job->m_stats.m_unused_vertex_count, "vertex", "vertices").c_str());
             }
-            else slot = it->second;
-            triangle.m_pa = slot;
 
-            object->push_triangle(triangle);
+            object_infos.push_back(object_info);
         }
 
-        // todo: optimize the object.
-
-        return object;
+        return object_infos;
     }
 
     std::vector<ObjectInfo> create_mesh_objects(
         asr::Assembly&          assembly,
-        INode*                  object_node,
+        Object*                 object,
+        MeshConversionJobMap&   converted_meshes)
+    {
+        // Meshes are converted ahead of time by add_objects().
+        const auto it = converted_meshes.find(object);
+        DbgAssert(it != converted_meshes.end());
+        if (it == converted_meshes.end())
+            return std::vector<ObjectInfo>();
+
+        const auto object_infos = insert_mesh_objects(assembly, it->second);
+        converted_meshes.erase(it);
+
+        return object_infos;
+    }
+
+    // Objects exported as curves. Their curves are created from the world state of their node.
+    typedef std::set<Object*> CurveShapeSet;
+
+    // Return true if an object is a shape that can be exported as curves rather than as a mesh.
+    bool has_curve_splines(const ObjectState& object_state)
+    {
+        return
+            object_state.obj->SuperClassID() == SHAPE_CLASS_ID &&
+            static_cast<ShapeObject*>(object_state.obj)->CanMakeBezier() != 0;
+    }
+
+    asr::GVector3 to_curve_point(const Point3& p)
+    {
+        // Like mesh vertices, curve points are expressed in the 3ds Max basis.
+        return asr::GVector3(p.x, p.y, p.z);
+    }
+
+    // Create cubic Bezier curve objects from the splines of a shape, one object per material ID.
+    // Curves are as wide as the rendered splines.
+    std::vector<ObjectInfo> create_curve_objects(
+        asr::Assembly&          assembly,
+        INode*                  node,
+        ShapeObject*            shape,
         const TimeValue         time)
     {
-        std::vector<ObjectInfo> object_infos;
+        BezierShape bezier_shape;
+        shape->MakeBezier(time, bezier_shape);
 
-        // Retrieve the GeomObject at the desired time.
-        const ObjectState object_state = object_node->EvalWorldState(time);
-        GeomObject* geom_object = static_cast<GeomObject*>(object_state.obj);
+        Interval thickness_validity(FOREVER);
+        const asr::GScalar width = static_cast<asr::GScalar>(shape->GetThickness(time, thickness_validity));
 
-        // Create one appleseed MeshObject per 3ds Max Mesh.
-        const int render_mesh_count = geom_object->NumberOfRenderMeshes();
-        if (render_mesh_count > 0)
+        std::map<MtlID, std::vector<asr::CurveObject::Curve3Type>> curves;
+        for (int i = 0; i < bezier_shape.splineCount; ++i)
         {
-            for (int i = 0; i < render_mesh_count; ++i)
+            Spline3D* spline = bezier_shape.splines[i];
+            spline->ComputeBezPoints();
+
+            const int knot_count = spline->KnotCount();
+            for (int seg = 0, seg_count = spline->Segments(); seg < seg_count; ++seg)
             {
-                NullView view;
-                BOOL need_delete;
-                Mesh* mesh = geom_object->GetMultipleRenderMesh(time, object_node, view, need_delete, i);
-                if (mesh != nullptr)
+                const int next = (seg + 1) % knot_count;
+                const asr::GVector3 control_points[4] =
                 {
-                    ObjectInfo object_info;
-                    object_info.m_name = wide_to_utf8(object_node->GetName());
-                    object_info.m_name = make_unique_name(assembly.objects(), object_info.m_name);
+                    to_curve_point(spline->GetKnotPoint(seg)),
+                    to_curve_point(spline->GetOutVec(seg)),
+                    to_curve_point(spline->GetInVec(next)),
+                    to_curve_point(spline->GetKnotPoint(next))
+                };
+                curves[spline->GetMatID(seg)].push_back(asr::CurveObject::Curve3Type(control_points, width));
+            }
+        }
 
-                    Matrix3 mesh_transform;
-                    Interval mesh_transform_validity;
-                    geom_object->GetMultipleRenderMeshTM(time, object_node, view, i, mesh_transform, mesh_transform_validity);
+        std::vector<ObjectInfo> object_infos;
+        const std::string name = wide_to_utf8(node->GetName());
 
-                    assembly.objects().insert(
-                        asf::auto_release_ptr<asr::Object>(
-                            convert_mesh_object(*mesh, mesh_transform, object_info)));
-            
-                    if (need_delete)
-                        mesh->DeleteThis();
+        for (const auto& entry : curves)
+        {
+            ObjectInfo object_info;
+            object_info.m_name = make_unique_name(assembly.objects(), name);
+            object_info.m_mtlid_to_slot.insert(entry.first, 0);
+            object_info.m_slot_names.push_back("default");
 
-                    object_infos.push_back(object_info);
-                }
-            }
+            asf::auto_release_ptr<asr::CurveObject> curve_object(
+                asr::CurveObjectFactory().create(object_info.m_name.c_str(), asr::ParamArray()));
+            curve_object->reserve_curves3(entry.second.size());
+            for (const auto& curve : entry.second)
+                curve_object->push_curve3(curve);
+
+            assembly.objects().insert(asf::auto_release_ptr<asr::Object>(curve_object));
+
+            object_infos.push_back(object_info);
         }
-        else
+
+        return object_infos;
+    }
+
+    // Objects whose geometry is read by appleseed from a mesh file instead of being exported.
+    typedef std::map<Object*, std::string> ProxyFileMap;
+
+    std::vector<ObjectInfo> create_proxy_objects(
+        asr::Assembly&          assembly,
+        INode*                  node,
+        const std::string&      filepath)
+    {
+        std::vector<ObjectInfo> object_infos;
+
+        asr::ParamArray params;
+        params.insert("filename", filepath);
+
+        const std::string name =
+            make_unique_name(assembly.objects(), wide_to_utf8(node->GetName()) + "_proxy");
+
+        asr::MeshObjectArray mesh_objects;
+        if (!asr::MeshObjectReader::read(asf::SearchPaths(), name.c_str(), params, mesh_objects))
         {
-            NullView view;
-            BOOL need_delete;
-            Mesh* mesh = geom_object->GetRenderMesh(time, object_node, view, need_delete);
-            if (mesh != nullptr)
-            {
-                ObjectInfo object_info;
-                object_info.m_name = wide_to_utf8(object_node->GetName());
-                object_info.m_name = make_unique_name(assembly.objects(), object_info.m_name);
+            RENDERER_LOG_ERROR(
+                "object \"%s\": failed to load proxy file %s.",
+                wide_to_utf8(node->GetName()).c_str(),
+                filepath.c_str());
+            return object_infos;
+        }
 
-                assembly.objects().insert(
-                    asf::auto_release_ptr<asr::Object>(
-                        convert_mesh_object(*mesh, Matrix3(TRUE), object_info)));
+        for (size_t i = 0, e = mesh_objects.size(); i < e; ++i)
+        {
+            asr::MeshObject* mesh_object = mesh_objects[i];
 
-                if (need_delete)
-                    mesh->DeleteThis();
+            ObjectInfo object_info;
+            object_info.m_name = mesh_object->get_name();
 
-                object_infos.push_back(object_info);
+            // Mesh files do not record 3ds Max material IDs: bind material slots to material IDs in order.
+            for (size_t slot = 0, slot_count = mesh_object->get_material_slot_count(); slot < slot_count; ++slot)
+            {
+                object_info.m_mtlid_to_slot.insert(static_cast<asf::uint16>(slot), static_cast<asf::uint32>(slot));
+                object_info.m_slot_names.push_back(mesh_object->get_material_slot(slot));
             }
+
+            // Saved projects reference the mesh file rather than embedding its geometry.
+            mesh_object->get_parameters().insert("filename", filepath);
+
+            assembly.objects().insert(asf::auto_release_ptr<asr::Object>(mesh_object));
+            object_infos.push_back(object_info);
         }
 
         return object_infos;
     }
 
+    std::vector<ObjectInfo> create_objects(
+        asr::Assembly&          assembly,
+        INode*                  node,
+        Object*                 object,
+        const TimeValue         time,
+        ObjectStateCache&       object_states,
+        MeshConversionJobMap&   converted_meshes,
+        const CurveShapeSet&    curve_shapes,
+        const ProxyFileMap&     proxy_files)
+    {
+        const auto proxy_it = proxy_files.find(object);
+        if (proxy_it != proxy_files.end())
+            return create_proxy_objects(assembly, node, proxy_it->second);
+
+        return
+            curve_shapes.find(object) != curve_shapes.end()
+                ? create_curve_objects(assembly, node, static_cast<ShapeObject*>(object_states.get(node).obj), time)
+                : create_mesh_objects(assembly, object, converted_meshes);
+    }
+
     typedef std::map<Mtl*, std::string> MaterialMap;
 
     struct MaterialInfo
@@ -390,12 +1327,27 @@ namespace
         int         m_sides;    // sides of the object to which the material must be applied
     };
 
+    std::string insert_material(
+        asr::Assembly&          assembly,
+        Mtl*                    mtl,
+        IAppleseedMtl*          appleseed_mtl,
+        const bool              use_max_procedural_maps)
+    {
+        const std::string name =
+            make_unique_name(assembly.materials(), wide_to_utf8(mtl->GetName()) + "_mat");
+        assembly.materials().insert(
+            appleseed_mtl->create_material(assembly, name.c_str(), use_max_procedural_maps));
+        return name;
+    }
+
     MaterialInfo get_or_create_material(
         asr::Assembly&          assembly,
         const std::string&      instance_name,
         Mtl*                    mtl,
         MaterialMap&            material_map,
-        const bool              use_max_procedural_maps)
+        MaterialCache*          material_cache,
+        const bool              use_max_procedural_maps,
+        const TimeValue         time)
     {
         MaterialInfo material_info;
 
@@ -407,11 +1359,21 @@ namespace
             const auto it = material_map.find(mtl);
             if (it == material_map.end())
             {
-                // The appleseed material does not exist yet, let the material plugin create it.
-                material_info.m_name =
-                    make_unique_name(assembly.materials(), wide_to_utf8(mtl->GetName()) + "_mat");
-                assembly.materials().insert(
-                    appleseed_mtl->create_material(assembly, material_info.m_name.c_str(), use_max_procedural_maps));
+                // The appleseed material does not exist yet. Reuse the entities built for a previous
+                // render if the material did not change, otherwise let the material plugin create it.
+                if (material_cache != nullptr)
+                {
+                    const asf::uint64 content_hash =
+                        MaterialCache::compute_content_hash(mtl, time, use_max_procedural_maps);
+                    if (!material_cache->fetch(mtl, content_hash, assembly, material_info.m_name))
+                    {
+                        const MaterialCache::Mark mark = MaterialCache::mark(assembly);
+                        material_info.m_name = insert_material(assembly, mtl, appleseed_mtl, use_max_procedural_maps);
+                        material_cache->insert(mtl, content_hash, material_info.m_name, assembly, mark);
+                    }
+                }
+                else material_info.m_name = insert_material(assembly, mtl, appleseed_mtl, use_max_procedural_maps);
+
                 material_map.insert(std::make_pair(mtl, material_info.m_name));
             }
             else
@@ -431,27 +1393,28 @@ namespace
         return material_info;
     }
 
-    asr::VisibilityFlags::Type get_visibility_flags(Object* object, const TimeValue time)
+    // Object properties set by an appleseed Object Properties modifier.
+    struct ObjectProperties
     {
-        if (object->SuperClassID() == GEN_DERIVOB_CLASS_ID)
+        asr::VisibilityFlags::Type  m_visibility_flags;
+        std::string                 m_sss_set;
+        bool                        m_optimize_for_instancing;
+        int                         m_subdivision_iterations;
+        std::string                 m_proxy_file;
+
+        ObjectProperties()
+          : m_visibility_flags(asr::VisibilityFlags::AllRays)
+          , m_optimize_for_instancing(false)
+          , m_subdivision_iterations(0)
         {
-            IDerivedObject* derived_object = static_cast<IDerivedObject*>(object);
-            for (int i = 0, e = derived_object->NumModifiers(); i < e; ++i)
-            {
-                Modifier* modifier = derived_object->GetModifier(i);
-                if (modifier->ClassID() == AppleseedObjPropsMod::get_class_id())
-                {
-                    const auto obj_props_mod = static_cast<const AppleseedObjPropsMod*>(modifier);
-                    return obj_props_mod->get_visibility_flags(time);
-                }
-            }
         }
+    };
 
-        return asr::VisibilityFlags::AllRays;
-    }
-
-    std::string get_sss_set(Object* object, const TimeValue time)
+    // Retrieve all the properties of an object in a single scan of its modifier stack.
+    ObjectProperties get_object_properties(Object* object, const TimeValue time)
     {
+        ObjectProperties properties;
+
         if (object->SuperClassID() == GEN_DERIVOB_CLASS_ID)
         {
             IDerivedObject* derived_object = static_cast<IDerivedObject*>(object);
@@ -461,33 +1424,44 @@ namespace
                 if (modifier->ClassID() == AppleseedObjPropsMod::get_class_id())
                 {
                     const auto obj_props_mod = static_cast<const AppleseedObjPropsMod*>(modifier);
-                    return obj_props_mod->get_sss_set(time);
+                    properties.m_visibility_flags = obj_props_mod->get_visibility_flags(time);
+                    properties.m_sss_set = obj_props_mod->get_sss_set(time);
+                    properties.m_subdivision_iterations = obj_props_mod->get_subdivision_iterations(time);
+                    properties.m_proxy_file = obj_props_mod->get_proxy_file(time);
+
+                    int optimize_for_instancing = 0;
+                    modifier->GetParamBlockByID(0)->GetValueByName(L"optimize_for_instancing", time, optimize_for_instancing, FOREVER);
+                    properties.m_optimize_for_instancing = optimize_for_instancing == TRUE;
+
+                    break;
                 }
             }
         }
 
-        return std::string();
+        return properties;
     }
 
-    bool should_optimize_for_instancing(Object* object, const TimeValue time)
+    // Properties of the objects of the scene, retrieved once per object for the whole export.
+    class ObjectPropertiesCache
     {
-        if (object->SuperClassID() == GEN_DERIVOB_CLASS_ID)
+      public:
+        explicit ObjectPropertiesCache(const TimeValue time)
+          : m_time(time)
         {
-            IDerivedObject* derived_object = static_cast<IDerivedObject*>(object);
-            for (int i = 0, e = derived_object->NumModifiers(); i < e; ++i)
-            {
-                Modifier* modifier = derived_object->GetModifier(i);
-                if (modifier->ClassID() == AppleseedObjPropsMod::get_class_id())
-                {
-                    int optimize_for_instancing = 0;
-                    modifier->GetParamBlockByID(0)->GetValueByName(L"optimize_for_instancing", time, optimize_for_instancing, FOREVER);
-                    return optimize_for_instancing == TRUE;
-                }
-            }
         }
 
-        return false;
-    }
+        const ObjectProperties& get(Object* object)
+        {
+            auto it = m_properties.find(object);
+            if (it == m_properties.end())
+                it = m_properties.insert(std::make_pair(object, get_object_properties(object, m_time))).first;
+            return it->second;
+        }
+
+      private:
+        const TimeValue                         m_time;
+        std::map<Object*, ObjectProperties>     m_properties;
+    };
 
     enum class RenderType
     {
@@ -495,23 +1469,29 @@ namespace
         MaterialPreview
     };
 
-    void create_object_instance(
+    // Front and back material mappings of an object instance.
+    struct MaterialMappings
+    {
+        asf::StringDictionary   m_front;
+        asf::StringDictionary   m_back;
+    };
+
+    // Retrieve or create the appleseed materials of a node and map them to the material slots
+    // of an object. Materials that are specific to an instance are named after `instance_name`.
+    MaterialMappings get_material_mappings(
         asr::Assembly&          assembly,
         INode*                  instance_node,
-        const asf::Transformd&  transform,
+        const std::string&      instance_name,
         const ObjectInfo&       object_info,
         const RenderType        type,
         const bool              use_max_proc_maps,
         const TimeValue         time,
-        MaterialMap&            material_map)
+        MaterialMap&            material_map,
+        MaterialCache*          material_cache)
     {
-        // Compute a unique name for this instance.
-        const std::string instance_name =
-            make_unique_name(assembly.object_instances(), object_info.m_name + "_inst");
-
-        // Material mappings.
-        asf::StringDictionary front_material_mappings;
-        asf::StringDictionary back_material_mappings;
+        MaterialMappings mappings;
+        asf::StringDictionary& front_material_mappings = mappings.m_front;
+        asf::StringDictionary& back_material_mappings = mappings.m_back;
 
         // Retrieve or create an appleseed material.
         Mtl* mtl = instance_node->GetMtl();
@@ -538,12 +1518,14 @@ namespace
                                 instance_name,
                                 submtl,
                                 material_map,
-                                use_max_proc_maps);
+                                material_cache,
+                                use_max_proc_maps,
+                                time);
 
-                        const auto entry = object_info.m_mtlid_to_slot.find(i);
-                        if (entry != object_info.m_mtlid_to_slot.end())
+                        const asf::uint32 slot = object_info.m_mtlid_to_slot.get_slot(static_cast<asf::uint16>(i));
+                        if (slot != MaterialSlotMap::InvalidSlot)
                         {
-                            const std::string slot_name = "material_slot_" + asf::to_string(entry->second);
+                            const std::string slot_name = get_material_slot_name(object_info, slot);
 
                             if (material_info.m_sides & asr::ObjectInstance::FrontSide)
                                 front_material_mappings.insert(slot_name, material_info.m_name);
@@ -565,12 +1547,14 @@ namespace
                         instance_name,
                         mtl,
                         material_map,
-                        use_max_proc_maps);
+                        material_cache,
+                        use_max_proc_maps,
+                        time);
 
                 // Assign it to all material slots.
-                for (const auto& entry : object_info.m_mtlid_to_slot)
+                for (const auto& entry : object_info.m_mtlid_to_slot.entries())
                 {
-                    const std::string slot_name = "material_slot_" + asf::to_string(entry.second);
+                    const std::string slot_name = get_material_slot_name(object_info, entry.second);
 
                     if (material_info.m_sides & asr::ObjectInstance::FrontSide)
                         front_material_mappings.insert(slot_name, material_info.m_name);
@@ -592,24 +1576,37 @@ namespace
                     to_color3f(Color(instance_node->GetWireColor())));
 
             // Assign it to all material slots.
-            for (const auto& entry : object_info.m_mtlid_to_slot)
+            for (const auto& entry : object_info.m_mtlid_to_slot.entries())
             {
-                const std::string slot_name = "material_slot_" + asf::to_string(entry.second);
+                const std::string slot_name = get_material_slot_name(object_info, entry.second);
                 front_material_mappings.insert(slot_name, material_name);
                 back_material_mappings.insert(slot_name, material_name);
             }
         }
 
+        return mappings;
+    }
+
+    void insert_object_instance(
+        asr::Assembly&          assembly,
+        INode*                  instance_node,
+        const std::string&      instance_name,
+        const asf::Transformd&  transform,
+        const ObjectInfo&       object_info,
+        const MaterialMappings& material_mappings,
+        const RenderType        type,
+        ObjectPropertiesCache&  object_properties)
+    {
         // Parameters.
+        const ObjectProperties& properties = object_properties.get(instance_node->GetObjectRef());
         asr::ParamArray params;
         params
             .insert(
                 "visibility",
-                asr::VisibilityFlags::to_dictionary(
-                    get_visibility_flags(instance_node->GetObjectRef(), time)))
+                asr::VisibilityFlags::to_dictionary(properties.m_visibility_flags))
             .insert(
                 "sss_set_id",
-                get_sss_set(instance_node->GetObjectRef(), time));
+                properties.m_sss_set);
         if (type == RenderType::MaterialPreview)
             params.insert_path("visibility.shadow", false);
 
@@ -620,46 +1617,293 @@ namespace
                 params,
                 object_info.m_name.c_str(),
                 transform,
-                front_material_mappings,
-                back_material_mappings));
+                material_mappings.m_front,
+                material_mappings.m_back));
+    }
+
+    void create_object_instance(
+        asr::Assembly&          assembly,
+        INode*                  instance_node,
+        const asf::Transformd&  transform,
+        const ObjectInfo&       object_info,
+        const RenderType        type,
+        const bool              use_max_proc_maps,
+        const TimeValue         time,
+        ObjectPropertiesCache&  object_properties,
+        MaterialMap&            material_map,
+        MaterialCache*          material_cache)
+    {
+        // Compute a unique name for this instance.
+        const std::string instance_name =
+            make_unique_name(assembly.object_instances(), object_info.m_name + "_inst");
+
+        insert_object_instance(
+            assembly,
+            instance_node,
+            instance_name,
+            transform,
+            object_info,
+            get_material_mappings(
+                assembly,
+                instance_node,
+                instance_name,
+                object_info,
+                type,
+                use_max_proc_maps,
+                time,
+                material_map,
+                material_cache),
+            type,
+            object_properties);
+    }
+
+    typedef std::map<Object*, std::vector<ObjectInfo>> ObjectMap;
+
+    // Nodes may only share the assembly of an object if their object instances are identical:
+    // same geometry, materials (or wire color in the absence of material) and object properties.
+    struct AssemblyKey
+    {
+        Object*                     m_object;
+        Mtl*                        m_mtl;
+        DWORD                       m_wire_color;
+        asr::VisibilityFlags::Type  m_visibility_flags;
+        std::string                 m_sss_set;
+
+        AssemblyKey(
+            INode*                  node,
+            Object*                 object,
+            ObjectPropertiesCache&  object_properties)
+          : m_object(object)
+          , m_mtl(node->GetMtl())
+          , m_wire_color(m_mtl == nullptr ? node->GetWireColor() : 0)
+        {
+            const ObjectProperties& properties = object_properties.get(node->GetObjectRef());
+            m_visibility_flags = properties.m_visibility_flags;
+            m_sss_set = properties.m_sss_set;
+        }
+
+        bool operator<(const AssemblyKey& rhs) const
+        {
+            if (m_object != rhs.m_object)
+                return m_object < rhs.m_object;
+            if (m_mtl != rhs.m_mtl)
+                return m_mtl < rhs.m_mtl;
+            if (m_wire_color != rhs.m_wire_color)
+                return m_wire_color < rhs.m_wire_color;
+            if (m_visibility_flags != rhs.m_visibility_flags)
+                return m_visibility_flags < rhs.m_visibility_flags;
+            return m_sss_set < rhs.m_sss_set;
+        }
+    };
+
+    typedef std::map<AssemblyKey, std::string> AssemblyMap;
+
+    // Return true if an object is worth moving to its own assembly: the cost of instantiating
+    // the object's assembly is then paid once instead of growing the top-level BVH with every
+    // triangle of every instance.
+    bool should_auto_optimize_for_instancing(
+        const size_t            instance_count,
+        const size_t            triangle_count,
+        const size_t            threshold)
+    {
+        return
+            instance_count > 1 &&
+            static_cast<asf::uint64>(instance_count) * triangle_count >= threshold;
+    }
+
+    // Create the appleseed materials of all objects, in export order, so that adding objects
+    // only has to look them up. Material plugins read parameter blocks, texture maps and bitmaps
+    // through the 3ds Max API, this must run on the main thread.
+    void create_materials(
+        asr::Assembly&          assembly,
+        const MaxSceneEntities& entities,
+        const RenderType        type,
+        const bool              use_max_proc_maps,
+        const TimeValue         time,
+        MaterialMap&            material_map,
+        MaterialCache*          material_cache)
+    {
+        std::vector<Mtl*> mtls;
+
+        for (const auto object_index : entities.m_export_order)
+        {
+            Mtl* mtl = entities.m_objects[object_index]->GetMtl();
+            if (mtl == nullptr)
+                continue;
+
+            // Trigger SME materials update.
+            if (type == RenderType::MaterialPreview)
+                mtl->Update(time, FOREVER);
+
+            mtls.clear();
+            const int submtlcount = mtl->NumSubMtls();
+            if (mtl->IsMultiMtl() && submtlcount > 0)
+            {
+                for (int i = 0; i < submtlcount; ++i)
+                    mtls.push_back(mtl->GetSubMtl(i));
+            }
+            else mtls.push_back(mtl);
+
+            // Other materials are replaced by empty materials when instances are created.
+            for (const auto m : mtls)
+            {
+                if (m != nullptr &&
+                    m->GetInterface(IAppleseedMtl::interface_id()) != nullptr &&
+                    material_map.find(m) == material_map.end())
+                {
+                    get_or_create_material(
+                        assembly,
+                        std::string(),
+                        m,
+                        material_map,
+                        material_cache,
+                        use_max_proc_maps,
+                        time);
+                }
+            }
+        }
     }
 
-    typedef std::map<Object*, std::vector<ObjectInfo>> ObjectMap;
-    typedef std::map<Object*, std::string> AssemblyMap;
+    // Create the objects of the unique shapes of a particle system once, and instantiate
+    // them once per particle.
+    void add_particles(
+        asr::Assembly&          assembly,
+        INode*                  node,
+        Object*                 object,
+        const ParticleSystem&   particle_system,
+        const RenderType        type,
+        const bool              use_max_proc_maps,
+        const TimeValue         time,
+        ObjectPropertiesCache&  object_properties,
+        ObjectMap&              object_map,
+        MaterialMap&            material_map,
+        MaterialCache*          material_cache,
+        MeshConversionJobMap&   converted_meshes)
+    {
+        ObjectMap::const_iterator it = object_map.find(object);
+        if (it == object_map.end())
+        {
+            const auto object_infos = create_mesh_objects(assembly, object, converted_meshes);
+            it = object_map.insert(std::make_pair(object, object_infos)).first;
+        }
+
+        const std::vector<ObjectInfo>& object_infos = it->second;
+        const std::vector<size_t>& shape_first_jobs = particle_system.m_shape_first_jobs;
+        const Matrix3 node_transform = node->GetObjTMAfterWSM(time);
+
+        // All particles share the materials of the node: resolve them once per shape object
+        // rather than once per particle, so that default materials are not created per particle.
+        std::vector<MaterialMappings> material_mappings;
+        material_mappings.reserve(object_infos.size());
+        for (const auto& object_info : object_infos)
+        {
+            material_mappings.push_back(
+                get_material_mappings(
+                    assembly,
+                    node,
+                    object_info.m_name + "_inst",
+                    object_info,
+                    type,
+                    use_max_proc_maps,
+                    time,
+                    material_map,
+                    material_cache));
+        }
+
+        for (const auto& particle : particle_system.m_particles)
+        {
+            const asf::Transformd transform =
+                asf::Transformd::from_local_to_parent(
+                    to_matrix4d(particle.m_transform * node_transform));
+
+            const size_t shape_end =
+                particle.m_shape + 1 < shape_first_jobs.size()
+                    ? shape_first_jobs[particle.m_shape + 1]
+                    : object_infos.size();
+
+            for (size_t i = shape_first_jobs[particle.m_shape]; i < shape_end; ++i)
+            {
+                insert_object_instance(
+                    assembly,
+                    node,
+                    make_unique_name(assembly.object_instances(), object_infos[i].m_name + "_inst"),
+                    transform,
+                    object_infos[i],
+                    material_mappings[i],
+                    type,
+                    object_properties);
+            }
+        }
+    }
 
+    // `object` is the object providing the geometry of `node`. It may differ from the object
+    // referenced by `node` when both objects have identical geometry.
     void add_object(
-        asr::Assembly&          assembly,
-        INode*                  node,
-        const RenderType        type,
-        const bool              use_max_proc_maps,
-        const TimeValue         time,
-        ObjectMap&              object_map,
-        MaterialMap&            material_map,
-        AssemblyMap&            assembly_map)
+        asr::Assembly&              assembly,
+        INode*                      node,
+        Object*                     object,
+        const bool                  own_assembly,
+        const RenderType            type,
+        const bool                  use_max_proc_maps,
+        const TimeValue             time,
+        ObjectPropertiesCache&      object_properties,
+        ObjectStateCache&           object_states,
+        ObjectMap&                  object_map,
+        MaterialMap&                material_map,
+        MaterialCache*              material_cache,
+        AssemblyMap&                assembly_map,
+        MeshConversionJobMap&       converted_meshes,
+        const ParticleSystemMap&    particle_systems,
+        const CurveShapeSet&        curve_shapes,
+        const ProxyFileMap&         proxy_files,
+        const MotionSampling&       motion)
     {
-        // Retrieve the geometrical object referenced by this node.
-        Object* object = node->GetObjectRef();
-
-        // Compute the transform of this instance.
-        const asf::Transformd transform =
-            asf::Transformd::from_local_to_parent(
-                to_matrix4d(node->GetObjTMAfterWSM(time)));
+        const auto particle_system_it = particle_systems.find(object);
+        if (particle_system_it != particle_systems.end())
+        {
+            add_particles(
+                assembly,
+                node,
+                object,
+                particle_system_it->second,
+                type,
+                use_max_proc_maps,
+                time,
+                object_properties,
+                object_map,
+                material_map,
+                material_cache,
+                converted_meshes);
+            return;
+        }
 
-        if (should_optimize_for_instancing(object, time))
+        // Check if we already generated the corresponding appleseed objects. Objects are always
+        // created in the parent assembly, so that assemblies of nodes with different materials
+        // or properties can instantiate them.
+        ObjectMap::const_iterator it = object_map.find(object);
+        if (it == object_map.end())
         {
-            std::string assembly_name = wide_to_utf8(node->GetName());
-            assembly_name = make_unique_name(assembly.assemblies(), assembly_name + "_assembly");
+            // The appleseed objects do not exist yet, create them.
+            const auto object_infos = create_objects(assembly, node, object, time, object_states, converted_meshes, curve_shapes, proxy_files);
+            it = object_map.insert(std::make_pair(object, object_infos)).first;
+        }
+
+        const std::vector<ObjectInfo>& object_infos = it->second;
 
-            const AssemblyMap::const_iterator it = assembly_map.find(object);
+        if (own_assembly)
+        {
+            const AssemblyKey key(node, object, object_properties);
+            const AssemblyMap::const_iterator assembly_it = assembly_map.find(key);
 
-            if (it == assembly_map.end())
+            std::string assembly_name;
+            if (assembly_it == assembly_map.end())
             {
                 // Create an assembly.
+                assembly_name = make_unique_name(assembly.assemblies(), wide_to_utf8(node->GetName()) + "_assembly");
                 asf::auto_release_ptr<asr::Assembly> object_assembly(
                     asr::AssemblyFactory().create(assembly_name.c_str()));
 
-                // Add objects and object instances to it.
-                const auto object_infos = create_mesh_objects(object_assembly.ref(), node, time);
+                // Add object instances to it.
                 for (const auto& object_info : object_infos)
                 {
                     create_object_instance(
@@ -670,17 +1914,19 @@ namespace
                         type,
                         use_max_proc_maps,
                         time,
-                        material_map);
+                        object_properties,
+                        material_map,
+                        material_cache);
                 }
 
-                assembly_map.insert(std::make_pair(object, assembly_name));
-                    
+                assembly_map.insert(std::make_pair(key, assembly_name));
+
                 // Insert the assembly into the scene.
                 assembly.assemblies().insert(object_assembly);
             }
             else
             {
-                assembly_name = it->second;
+                assembly_name = assembly_it->second;
             }
 
             // Create an instance of the assembly and insert it into the scene.
@@ -692,82 +1938,706 @@ namespace
                     asr::ParamArray(),
                     assembly_name.c_str()));
 
-            object_assembly_instance->transform_sequence()
-                .set_transform(0.0, transform);
+            // Object instances have a single transform, moving nodes are blurred by their assembly instance.
+            set_transform_keys(
+                object_assembly_instance->transform_sequence(),
+                sample_object_transforms(node, motion),
+                motion);
 
             assembly.assembly_instances().insert(object_assembly_instance);
         }
         else
         {
-            // Check if we already generated the corresponding appleseed objects.
-            const ObjectMap::const_iterator it = object_map.find(object);
-            if (it == object_map.end())
-            {
-                // The appleseed objects do not exist yet, create and instantiate them.
-                const auto object_infos = create_mesh_objects(assembly, node, time);
-                object_map.insert(std::make_pair(object, object_infos));
+            // Compute the transform of this instance.
+            const asf::Transformd transform =
+                asf::Transformd::from_local_to_parent(
+                    to_matrix4d(node->GetObjTMAfterWSM(time)));
 
-                for (const auto& object_info : object_infos)
-                {
-                    create_object_instance(
-                        assembly,
-                        node,
-                        transform,
-                        object_info,
-                        type,
-                        use_max_proc_maps,
-                        time,
-                        material_map);
-                }
+            // Instantiate the appleseed objects.
+            for (const auto& object_info : object_infos)
+            {
+                create_object_instance(
+                    assembly,
+                    node,
+                    transform,
+                    object_info,
+                    type,
+                    use_max_proc_maps,
+                    time,
+                    object_properties,
+                    material_map,
+                    material_cache);
             }
-            else
+        }
+    }
+
+    // An object whose geometry may be reused by later objects with the same content hash.
+    struct ContentSource
+    {
+        Object*                 m_object;
+        INode*                  m_node;
+        MeshConversionParams    m_params;
+    };
+
+    bool are_snapshots_processed(const MeshConversionJobs& jobs)
+    {
+        return !jobs.empty() && jobs.front()->m_snapshot_processed;
+    }
+
+    // Return true if the snapshots of an object are identical to the ones of a source object with
+    // the same content hash. The snapshots of the source object are still held if it belongs to
+    // the current batch, otherwise they are fetched from the geometry cache or taken again.
+    bool has_same_geometry(
+        const MeshConversionJobs&       jobs,
+        const ContentSource&            source,
+        const MeshConversionJobMap&     converted_meshes,
+        const std::set<Object*>&        batch_objects,
+        GeometryCache*                  geometry_cache,
+        const TimeValue                 time,
+        const MotionSampling&           motion,
+        ObjectStateCache&               object_states)
+    {
+        const bool processed = are_snapshots_processed(jobs);
+
+        if (batch_objects.find(source.m_object) != batch_objects.end())
+        {
+            const auto it = converted_meshes.find(source.m_object);
+            if (it != converted_meshes.end() && are_snapshots_processed(it->second) == processed)
+                return are_snapshots_identical(it->second, jobs);
+        }
+
+        const Interval interval = motion.m_deformation ? motion.get_shutter_interval() : Interval(time, time);
+
+        MeshConversionJobs source_jobs;
+        if (processed)
+        {
+            // Cached snapshots are welded and optimized: only compare them to cached snapshots.
+            if (geometry_cache == nullptr ||
+                !geometry_cache->fetch(source.m_node, source.m_object, interval, source.m_params, source_jobs))
+                return false;
+        }
+        else
+        {
+            take_mesh_snapshots(
+                source.m_node,
+                object_states.get(source.m_node),
+                time,
+                source.m_params,
+                source_jobs);
+
+            if (!jobs.empty() && !jobs.front()->m_snapshot.m_vertex_poses.empty())
+                take_deformation_snapshots(source.m_node, motion, source.m_params, object_states, source_jobs);
+        }
+
+        return are_snapshots_identical(source_jobs, jobs);
+    }
+
+    // An object whose mesh snapshots are moved to the geometry cache once converted.
+    struct CacheableObject
+    {
+        INode*                  m_node;
+        Object*                 m_object;
+        Interval                m_validity;
+        MeshConversionParams    m_params;
+    };
+
+    size_t get_mesh_conversion_thread_count(const int rendering_threads)
+    {
+        // Same semantics as the rendering threads setting.
+        const int core_count = static_cast<int>(asf::System::get_logical_cpu_core_count());
+        const int thread_count =
+            rendering_threads == 0 ? core_count :
+            rendering_threads > 0 ? rendering_threads :
+            core_count + rendering_threads;
+        return static_cast<size_t>(std::max(thread_count, 1));
+    }
+
+    // Report what entity collection found in the scene.
+    void log_scene_nodes(const MaxSceneEntities& entities)
+    {
+        size_t object_count = 0, particle_system_count = 0;
+        size_t light_count = 0, camera_count = 0, helper_count = 0;
+        size_t triangle_count = 0;
+
+        for (const auto& node_info : entities.m_nodes)
+        {
+            switch (node_info.m_type)
             {
-                // The appleseed objects already exist, simply instantiate them.
-                for (const auto& object_info : it->second)
+              case MaxSceneEntities::NodeType::Particles:
+                if (node_info.m_renderable)
+                    ++particle_system_count;
+                // Fall through.
+
+              case MaxSceneEntities::NodeType::Geometry:
+                if (node_info.m_renderable)
                 {
-                    create_object_instance(
-                        assembly,
-                        node,
-                        transform,
-                        object_info,
-                        type,
-                        use_max_proc_maps,
-                        time,
-                        material_map);
+                    ++object_count;
+                    triangle_count += node_info.m_triangle_count;
                 }
+                break;
+
+              case MaxSceneEntities::NodeType::Light:
+                if (node_info.m_renderable)
+                    ++light_count;
+                break;
+
+              case MaxSceneEntities::NodeType::Camera:
+                ++camera_count;
+                break;
+
+              case MaxSceneEntities::NodeType::Helper:
+                ++helper_count;
+                break;
+
+              default:
+                break;
             }
         }
+
+        RENDERER_LOG_INFO(
+            "scene has %s %s: %s renderable %s (%s particle %s, about %s %s), %s %s, %s %s and %s %s.",
+            asf::pretty_uint(entities.m_nodes.size()).c_str(),
+            asf::plural(entities.m_nodes.size(), "node").c_str(),
+            asf::pretty_uint(object_count).c_str(),
+            asf::plural(object_count, "object").c_str(),
+            asf::pretty_uint(particle_system_count).c_str(),
+            asf::plural(particle_system_count, "system").c_str(),
+            asf::pretty_uint(triangle_count).c_str(),
+            asf::plural(triangle_count, "face").c_str(),
+            asf::pretty_uint(light_count).c_str(),
+            asf::plural(light_count, "light").c_str(),
+            asf::pretty_uint(camera_count).c_str(),
+            asf::plural(camera_count, "camera").c_str(),
+            asf::pretty_uint(helper_count).c_str(),
+            asf::plural(helper_count, "helper").c_str());
     }
 
     void add_objects(
         asr::Assembly&          assembly,
         const MaxSceneEntities& entities,
         const RenderType        type,
-        const bool              use_max_proc_maps,
+        const RendererSettings& settings,
         const TimeValue         time,
         ObjectMap&              object_map,
         MaterialMap&            material_map,
+        MaterialCache*          material_cache,
         AssemblyMap&            assembly_map,
+        GeometryCache*          geometry_cache,
         RendProgressCallback*   progress_cb)
     {
-        for (size_t i = 0, e = entities.m_objects.size(); i < e; ++i)
+        log_scene_nodes(entities);
+
+        // Maximum number of triangles held in memory by a batch of mesh snapshots.
+        const size_t MaxBatchTriangleCount = 8 * 1000 * 1000;
+
+        const size_t thread_count =
+            settings.m_parallel_mesh_conversion
+                ? get_mesh_conversion_thread_count(settings.m_rendering_threads)
+                : 1;
+
+        MeshConversionParams params;
+        params.m_weld_vertex_attributes = settings.m_weld_vertex_attributes;
+        params.m_weld_tolerance = settings.m_weld_tolerance;
+        params.m_optimize = settings.m_optimize_meshes;
+
+        const MotionSampling motion(settings, time);
+        size_t deforming_object_count = 0;
+
+        ObjectPropertiesCache object_properties(time);
+        ObjectStateCache object_states(entities, time);
+        ParticleSystemMap particle_systems;
+        size_t particle_count = 0;
+        CurveShapeSet curve_shapes;
+        ProxyFileMap proxy_files;
+        MeshConversionJobMap converted_meshes;
+        MeshConversionStats stats;
+        size_t cached_object_count = 0;
+        size_t cached_triangle_count = 0;
+
+        // Objects whose geometry is identical to the one of a previous object
+        // are instantiated from the appleseed objects of that previous object.
+        typedef std::pair<asf::uint64, bool> ContentKey;     // content hash, own assembly
+        std::map<ContentKey, ContentSource> content_map;
+        std::map<Object*, Object*> object_aliases;
+        size_t saved_size = 0;
+
+        // Objects are moved to their own assembly either on request, or automatically when
+        // they are instantiated enough times. Instances of aliases count as instances of
+        // the object they alias, provided the alias is found before that object is added.
+        std::map<Object*, size_t> instance_counts;
+        std::map<Object*, std::vector<INode*>> object_nodes;
+        for (const auto node : entities.m_objects)
         {
-            const auto& object = entities.m_objects[i];
-            add_object(
-                assembly,
-                object,
-                type,
-                use_max_proc_maps,
-                time,
-                object_map,
-                material_map,
-                assembly_map);
+            ++instance_counts[node->GetObjectRef()];
+            object_nodes[node->GetObjectRef()].push_back(node);
+        }
+        std::map<Object*, bool> own_assembly_objects;
+        size_t auto_assembly_count = 0;
+
+        // Nodes that move while the shutter is open, decided before any object is added. Moving
+        // nodes are instantiated through an assembly whatever the object they reference or alias.
+        std::vector<bool> moving_nodes(entities.m_objects.size(), false);
+        size_t moving_node_count = 0;
+        if (motion.is_enabled())
+        {
+            for (size_t i = 0, e = entities.m_objects.size(); i < e; ++i)
+            {
+                if (sample_object_transforms(entities.m_objects[i], motion).size() > 1)
+                {
+                    moving_nodes[i] = true;
+                    ++moving_node_count;
+                }
+            }
+        }
 
-            const int done = static_cast<int>(i);
-            const int total = static_cast<int>(e);
-            if (progress_cb->Progress(done + 1, total) == RENDPROG_ABORT)
-                break;
+        // Materials are created once, during the conversion of the first batch of meshes.
+        bool materials_created = false;
+        size_t batch_count = 0;
+
+        for (size_t i = 0, e = entities.m_objects.size(); i < e; )
+        {
+            // Snapshot the meshes of the next batch of objects on the main thread.
+            std::vector<MeshConversionJob*> batch_jobs;
+            std::vector<CacheableObject> batch_cacheable_objects;
+            std::set<Object*> batch_objects;
+            size_t batch_triangle_count = 0;
+            size_t batch_split_part_count = 0;
+            size_t batch_end = i;
+            for (; batch_end < e && batch_triangle_count < MaxBatchTriangleCount; ++batch_end)
+            {
+                const size_t object_index = entities.m_export_order[batch_end];
+                INode* node = entities.m_objects[object_index];
+                Object* object = node->GetObjectRef();
+
+                // Skip objects that were already converted.
+                if (converted_meshes.find(object) != converted_meshes.end() ||
+                    object_aliases.find(object) != object_aliases.end() ||
+                    object_map.find(object) != object_map.end() ||
+                    curve_shapes.find(object) != curve_shapes.end() ||
+                    proxy_files.find(object) != proxy_files.end())
+                    continue;
+
+                // Proxies are neither evaluated nor converted: appleseed reads their mesh file.
+                const std::string& proxy_file = object_properties.get(object).m_proxy_file;
+                if (!proxy_file.empty())
+                {
+                    proxy_files.insert(std::make_pair(object, proxy_file));
+                    continue;
+                }
+
+                // Renderable splines may be exported as curves, created when the object is added.
+                const ObjectState& object_state = object_states.get(object_index);
+                if (settings.m_spline_curves && has_curve_splines(object_state))
+                {
+                    curve_shapes.insert(object);
+                    continue;
+                }
+
+                auto& jobs = converted_meshes[object];
+                bool cacheable = false;
+                Interval validity;
+
+                // Only export the map channels used by the materials of the object's nodes.
+                MeshConversionParams object_params = params;
+                object_params.m_map_channels = get_map_channels(object_nodes[object]);
+
+                // Subdivide the base mesh on worker threads rather than exporting a smoothed mesh.
+                object_params.m_subdivision_iterations = object_properties.get(object).m_subdivision_iterations;
+
+                // Particle systems are exported as instances of their unique shapes. They are
+                // neither cached nor instantiated automatically.
+                const bool has_particles = has_particle_shapes(object_state);
+
+                if (has_particles)
+                {
+                    ParticleSystem& particle_system = particle_systems[object];
+                    validity =
+                        take_particle_snapshots(
+                            node,
+                            object_state,
+                            time,
+                            object_params,
+                            jobs,
+                            particle_system);
+                    particle_count += particle_system.m_particles.size();
+                }
+                else if (geometry_cache != nullptr &&
+                         geometry_cache->fetch(
+                             node,
+                             object,
+                             motion.m_deformation ? motion.get_shutter_interval() : Interval(time, time),
+                             object_params,
+                             jobs))
+                {
+                    // Only convert the cached snapshots, skipping their evaluation and welding.
+                    for (auto& job : jobs)
+                    {
+                        job->m_name = wide_to_utf8(node->GetName());
+                        cached_triangle_count += job->m_snapshot.m_triangles.size();
+                    }
+                    ++cached_object_count;
+                }
+                else
+                {
+                    validity =
+                        take_mesh_snapshots(
+                            node,
+                            object_state,
+                            time,
+                            object_params,
+                            jobs,
+                            false,
+                            &batch_split_part_count);
+                    cacheable = geometry_cache != nullptr;
+
+                    // Objects that deform while the shutter is open get a vertex pose per motion key.
+                    // They are not cached since their poses depend on the shutter.
+                    if (motion.m_deformation && !validity.InInterval(motion.get_shutter_interval()))
+                    {
+                        if (take_deformation_snapshots(node, motion, object_params, object_states, jobs))
+                            ++deforming_object_count;
+                        else
+                        {
+                            RENDERER_LOG_WARNING(
+                                "object \"%s\": topology changes while the shutter is open, deformation blur is disabled.",
+                                wide_to_utf8(node->GetName()).c_str());
+                        }
+                        cacheable = false;
+                    }
+                }
+
+                // Look for a previous object with identical geometry. Matching hashes are
+                // confirmed by comparing the snapshots.
+                bool is_alias = false;
+                if (settings.m_auto_instancing && !has_particles)
+                {
+                    const ContentKey key(
+                        compute_content_hash(jobs),
+                        object_properties.get(object).m_optimize_for_instancing);
+                    const auto it = content_map.find(key);
+                    if (it == content_map.end())
+                    {
+                        ContentSource source;
+                        source.m_object = object;
+                        source.m_node = node;
+                        source.m_params = object_params;
+                        content_map.insert(std::make_pair(key, source));
+                    }
+                    else if (has_same_geometry(jobs, it->second, converted_meshes, batch_objects, geometry_cache, time, motion, object_states))
+                    {
+                        Object* source_object = it->second.m_object;
+                        object_aliases.insert(std::make_pair(object, source_object));
+                        instance_counts[source_object] += instance_counts[object];
+                        for (const auto& job : jobs)
+                            saved_size += estimate_mesh_object_size(job->m_snapshot);
+                        is_alias = true;
+                    }
+                }
+
+                // Aliases are not converted. They are only processed to be stored in the geometry cache.
+                if (is_alias && !cacheable)
+                {
+                    converted_meshes.erase(object);
+                    continue;
+                }
+
+                batch_objects.insert(object);
+
+                for (const auto& job : jobs)
+                {
+                    job->m_keep_snapshot = cacheable;
+                    job->m_convert = !is_alias;
+                    batch_jobs.push_back(job.get());
+                    batch_triangle_count += job->m_snapshot.m_triangles.size();
+                }
+
+                if (cacheable)
+                {
+                    CacheableObject cacheable_object;
+                    cacheable_object.m_node = node;
+                    cacheable_object.m_object = object;
+                    cacheable_object.m_validity = validity;
+                    cacheable_object.m_params = object_params;
+                    batch_cacheable_objects.push_back(cacheable_object);
+                }
+            }
+
+            // Convert the meshes of this batch, on worker threads in parallel mode.
+            // Start with the largest meshes so that workers finish at about the same time.
+            std::stable_sort(
+                batch_jobs.begin(),
+                batch_jobs.end(),
+                [](const MeshConversionJob* lhs, const MeshConversionJob* rhs)
+                {
+                    return lhs->m_snapshot.m_triangles.size() > rhs->m_snapshot.m_triangles.size();
+                });
+
+            if (!materials_created)
+            {
+                // Create materials on the main thread, while workers convert the first batch in parallel mode.
+                // Conversion errors are rethrown on the main thread once the conversion thread is joined.
+                std::thread conversion_thread;
+                std::exception_ptr conversion_error;
+                if (thread_count > 1)
+                {
+                    conversion_thread =
+                        std::thread(
+                            [&batch_jobs, thread_count, &conversion_error]()
+                            {
+                                try
+                                {
+                                    execute_mesh_conversion_jobs(batch_jobs, thread_count);
+                                }
+                                catch (...)
+                                {
+                                    conversion_error = std::current_exception();
+                                }
+                            });
+                }
+
+                // Material plugins may throw: a joinable thread must not be destroyed.
+                try
+                {
+                    create_materials(
+                        assembly,
+                        entities,
+                        type,
+                        settings.m_use_max_procedural_maps,
+                        time,
+                        material_map,
+                        material_cache);
+                }
+                catch (...)
+                {
+                    if (conversion_thread.joinable())
+                        conversion_thread.join();
+                    throw;
+                }
+
+                if (conversion_thread.joinable())
+                    conversion_thread.join();
+                else execute_mesh_conversion_jobs(batch_jobs, thread_count);
+
+                if (conversion_error)
+                    std::rethrow_exception(conversion_error);
+
+                materials_created = true;
+            }
+            else execute_mesh_conversion_jobs(batch_jobs, thread_count);
+
+            size_t batch_converted_triangle_count = 0;
+            for (const auto job : batch_jobs)
+            {
+                if (job->m_convert)
+                {
+                    stats += job->m_stats;
+                    batch_converted_triangle_count += job->m_stats.m_triangle_count;
+                }
+            }
+
+            // Report the memory used by each batch next to the number of parts of the meshes
+            // split into chunks of at most MaxChunkFaceCount faces.
+            ++batch_count;
+            RENDERER_LOG_INFO(
+                "mesh conversion batch %s: %s %s in %s %s, including %s %s of split meshes; working set: %s (peak: %s).",
+                asf::pretty_uint(batch_count).c_str(),
+                asf::pretty_uint(batch_converted_triangle_count).c_str(),
+                asf::plural(batch_converted_triangle_count, "triangle").c_str(),
+                asf::pretty_uint(batch_jobs.size()).c_str(),
+                asf::plural(batch_jobs.size(), "job").c_str(),
+                asf::pretty_uint(batch_split_part_count).c_str(),
+                asf::plural(batch_split_part_count, "part").c_str(),
+                asf::pretty_size(get_working_set_size()).c_str(),
+                asf::pretty_size(get_peak_working_set_size()).c_str());
+
+            // Move the snapshots of newly evaluated objects to the geometry cache.
+            for (const auto& entry : batch_cacheable_objects)
+            {
+                geometry_cache->insert(entry.m_node, entry.m_object, entry.m_validity, entry.m_params, converted_meshes[entry.m_object]);
+
+                if (object_aliases.find(entry.m_object) != object_aliases.end())
+                    converted_meshes.erase(entry.m_object);
+            }
+
+            // Insert objects in export order so that the project is deterministic.
+            for (; i < batch_end; ++i)
+            {
+                const size_t object_index = entities.m_export_order[i];
+                INode* node = entities.m_objects[object_index];
+                Object* object = node->GetObjectRef();
+
+                const auto alias_it = object_aliases.find(object);
+                if (alias_it != object_aliases.end())
+                    object = alias_it->second;
+
+                // Decide once per object whether it gets its own assembly.
+                auto own_assembly_it = own_assembly_objects.find(object);
+                if (own_assembly_it == own_assembly_objects.end())
+                {
+                    bool own_assembly = object_properties.get(object).m_optimize_for_instancing;
+
+                    if (!own_assembly &&
+                        settings.m_auto_assembly_instancing &&
+                        particle_systems.find(object) == particle_systems.end())
+                    {
+                        size_t triangle_count = 0;
+                        const auto jobs_it = converted_meshes.find(object);
+                        if (jobs_it != converted_meshes.end())
+                        {
+                            for (const auto& job : jobs_it->second)
+                                triangle_count += job->m_stats.m_triangle_count;
+                        }
+
+                        own_assembly =
+                            should_auto_optimize_for_instancing(
+                                instance_counts[object],
+                                triangle_count,
+                                static_cast<size_t>(settings.m_assembly_instancing_threshold));
+
+                        if (own_assembly)
+                            ++auto_assembly_count;
+                    }
+
+                    own_assembly_it = own_assembly_objects.insert(std::make_pair(object, own_assembly)).first;
+                }
+
+                // Object instances have a single transform while assembly instances have one per motion key.
+                const bool own_assembly =
+                    own_assembly_it->second ||
+                    (moving_nodes[object_index] && particle_systems.find(object) == particle_systems.end());
+
+                add_object(
+                    assembly,
+                    node,
+                    object,
+                    own_assembly,
+                    type,
+                    settings.m_use_max_procedural_maps,
+                    time,
+                    object_properties,
+                    object_states,
+                    object_map,
+                    material_map,
+                    material_cache,
+                    assembly_map,
+                    converted_meshes,
+                    particle_systems,
+                    curve_shapes,
+                    proxy_files,
+                    motion);
+
+                const int done = static_cast<int>(i);
+                const int total = static_cast<int>(e);
+                if (progress_cb->Progress(done + 1, total) == RENDPROG_ABORT)
+                    return;
+            }
+        }
+
+        RENDERER_LOG_INFO(
+            "converted %s %s using %s %s.",
+            asf::pretty_uint(stats.m_triangle_count).c_str(),
+            asf::plural(stats.m_triangle_count, "triangle").c_str(),
+            asf::pretty_uint(thread_count).c_str(),
+            asf::plural(thread_count, "thread").c_str());
+
+        if (params.m_optimize)
+        {
+            RENDERER_LOG_INFO(
+                "mesh optimization removed %s degenerate and %s duplicate %s, and %s unused %s.",
+                asf::pretty_uint(stats.m_degenerate_triangle_count).c_str(),
+                asf::pretty_uint(stats.m_duplicate_triangle_count).c_str(),
+                asf::plural(stats.m_duplicate_triangle_count, "triangle").c_str(),
+                asf::pretty_uint(stats.m_unused_vertex_count).c_str(),
+                asf::plural(stats.m_unused_vertex_count, "vertex", "vertices").c_str());
+        }
+
+        if (geometry_cache != nullptr)
+        {
+            RENDERER_LOG_INFO(
+                "reused %s cached %s (%s %s); geometry cache holds %s %s.",
+                asf::pretty_uint(cached_object_count).c_str(),
+                asf::plural(cached_object_count, "object").c_str(),
+                asf::pretty_uint(cached_triangle_count).c_str(),
+                asf::plural(cached_triangle_count, "triangle").c_str(),
+                asf::pretty_uint(geometry_cache->get_triangle_count()).c_str(),
+                asf::plural(geometry_cache->get_triangle_count(), "triangle").c_str());
+        }
+
+        if (material_cache != nullptr)
+        {
+            RENDERER_LOG_INFO(
+                "reused %s cached %s.",
+                asf::pretty_uint(material_cache->get_reused_material_count()).c_str(),
+                asf::plural(material_cache->get_reused_material_count(), "material").c_str());
+        }
+
+        if (params.m_weld_vertex_attributes)
+        {
+            RENDERER_LOG_INFO(
+                "welded %s vertex %s into %s and %s texture coordinates into %s.",
+                asf::pretty_uint(stats.m_input_vertex_normal_count).c_str(),
+                asf::plural(stats.m_input_vertex_normal_count, "normal").c_str(),
+                asf::pretty_uint(stats.m_output_vertex_normal_count).c_str(),
+                asf::pretty_uint(stats.m_input_tex_coords_count).c_str(),
+                asf::pretty_uint(stats.m_output_tex_coords_count).c_str());
+        }
+
+        if (!particle_systems.empty())
+        {
+            size_t shape_count = 0;
+            for (const auto& entry : particle_systems)
+                shape_count += entry.second.m_shape_first_jobs.size();
+
+            RENDERER_LOG_INFO(
+                "exported %s %s as instances of %s unique %s.",
+                asf::pretty_uint(particle_count).c_str(),
+                asf::plural(particle_count, "particle").c_str(),
+                asf::pretty_uint(shape_count).c_str(),
+                asf::plural(shape_count, "shape").c_str());
+        }
+
+        if (!proxy_files.empty())
+        {
+            RENDERER_LOG_INFO(
+                "exported %s %s as mesh file proxies.",
+                asf::pretty_uint(proxy_files.size()).c_str(),
+                asf::plural(proxy_files.size(), "object").c_str());
+        }
+
+        if (motion.is_enabled())
+        {
+            RENDERER_LOG_INFO(
+                "motion blur: sampled %s moving and %s deforming %s at %s motion keys.",
+                asf::pretty_uint(moving_node_count).c_str(),
+                asf::pretty_uint(deforming_object_count).c_str(),
+                asf::plural(deforming_object_count, "object").c_str(),
+                asf::pretty_uint(motion.m_times.size()).c_str());
         }
+
+        if (settings.m_auto_instancing)
+        {
+            RENDERER_LOG_INFO(
+                "automatic instancing: %s %s reuse the geometry of other objects, saving approximately %s.",
+                asf::pretty_uint(object_aliases.size()).c_str(),
+                asf::plural(object_aliases.size(), "object").c_str(),
+                asf::pretty_size(saved_size).c_str());
+        }
+
+        if (settings.m_auto_assembly_instancing)
+        {
+            RENDERER_LOG_INFO(
+                "automatic assembly instancing: moved %s %s to %s own %s.",
+                asf::pretty_uint(auto_assembly_count).c_str(),
+                asf::plural(auto_assembly_count, "object").c_str(),
+                auto_assembly_count == 1 ? "its" : "their",
+                asf::plural(auto_assembly_count, "assembly", "assemblies").c_str());
+        }
+
+        // Let users check that exporting large meshes did not exhaust physical memory.
+        RENDERER_LOG_INFO(
+            "working set after mesh conversion: %s (peak: %s).",
+            asf::pretty_size(get_working_set_size()).c_str(),
+            asf::pretty_size(get_peak_working_set_size()).c_str());
     }
 
     void add_omni_light(
@@ -1083,6 +2953,8 @@ namespace
         const RenderType                    type,
         const RendererSettings&             settings,
         const TimeValue                     time,
+        GeometryCache*                      geometry_cache,
+        MaterialCache*                      material_cache,
         RendProgressCallback*               progress_cb)
     {
         // Add objects, object instances and materials to the assembly.
@@ -1093,11 +2965,13 @@ namespace
             assembly,
             entities,
             type,
-            settings.m_use_max_procedural_maps,
+            settings,
             time,
             object_map,
             material_map,
+            material_cache,
             assembly_map,
+            geometry_cache,
             progress_cb);
 
         // Only add non-physical lights. Light-emitting materials were added by material plugins.
@@ -1522,13 +3396,21 @@ asf::auto_release_ptr<asr::Camera> build_camera(
 {
     asf::auto_release_ptr<renderer::Camera> camera;
 
+    const MotionSampling motion(settings, time);
+
+    asr::ParamArray params;
+    if (motion.is_enabled())
+    {
+        params.insert("shutter_open_time", motion.m_key_times.front());
+        params.insert("shutter_close_time", motion.m_key_times.back());
+    }
+
     if (view_params.projType == PROJ_PARALLEL)
     {
         //
         // Orthographic camera.
         //
 
-        asr::ParamArray params;
 
         // Film dimensions.
         const float ViewDefaultWidth = 400.0f;
@@ -1548,7 +3430,6 @@ asf::auto_release_ptr<asr::Camera> build_camera(
 
         DbgAssert(view_params.projType == PROJ_PERSPECTIVE);
 
-        asr::ParamArray params;
         params.insert("horizontal_fov", asf::rad_to_deg(view_params.fov));
 
 #if MAX_RELEASE >= 18000
@@ -1576,12 +3457,24 @@ asf::auto_release_ptr<asr::Camera> build_camera(
         }
     }
 
-    // Set camera transform.
-    camera->transform_sequence().set_transform(
-        0.0,
-        asf::Transformd::from_local_to_parent(
-            asf::Matrix4d::make_scaling(asf::Vector3d(settings.m_scale_multiplier)) *
-            to_matrix4d(Inverse(view_params.affineTM))));
+    // Set camera transform, with a key per motion key if the view node moves.
+    std::vector<Matrix3> camera_transforms(1, Inverse(view_params.affineTM));
+    if (view_node != nullptr && motion.is_enabled())
+    {
+        const std::vector<Matrix3> node_transforms = sample_object_transforms(view_node, motion);
+        const Matrix3 node_to_camera = camera_transforms.front() * Inverse(node_transforms.front());
+        for (size_t i = 1, e = node_transforms.size(); i < e; ++i)
+            camera_transforms.push_back(node_to_camera * node_transforms[i]);
+    }
+
+    for (size_t i = 0, e = camera_transforms.size(); i < e; ++i)
+    {
+        camera->transform_sequence().set_transform(
+            motion.m_key_times[i],
+            asf::Transformd::from_local_to_parent(
+                asf::Matrix4d::make_scaling(asf::Vector3d(settings.m_scale_multiplier)) *
+                to_matrix4d(camera_transforms[i])));
+    }
 
     return camera;
 }
@@ -1596,8 +3489,16 @@ asf::auto_release_ptr<asr::Project> build_project(
     const RendererSettings&                 settings,
     Bitmap*                                 bitmap,
     const TimeValue                         time,
+    GeometryCache*                          geometry_cache,
+    MaterialCache*                          material_cache,
     RendProgressCallback*                   progress_cb)
 {
+    // Generate unique entity names without scanning entity containers.
+    UniqueNameRegistry unique_names;
+
+    // Build the layers of each sub-material once per parent shader group.
+    SubMaterialLayerRegistry sub_material_layers;
+
     // Create an empty project.
     asf::auto_release_ptr<asr::Project> project(
         asr::ProjectFactory::create("project"));
@@ -1637,8 +3538,20 @@ asf::auto_release_ptr<asr::Project> build_project(
         type,
         settings,
         time,
+        geometry_cache,
+        material_cache,
         progress_cb);
 
+    if (sub_material_layers.get_copied_layer_count() > 0)
+    {
+        RENDERER_LOG_INFO(
+            "copied %s sub-material shader %s into parent shader groups and avoided %s redundant %s.",
+            asf::pretty_uint(sub_material_layers.get_copied_layer_count()).c_str(),
+            asf::plural(sub_material_layers.get_copied_layer_count(), "layer").c_str(),
+            asf::pretty_uint(sub_material_layers.get_reused_layer_count()).c_str(),
+            asf::plural(sub_material_layers.get_reused_layer_count(), "copy", "copies").c_str());
+    }
+
     // Create an instance of the assembly and insert it into the scene.
     asf::auto_release_ptr<asr::AssemblyInstance> assembly_instance(
         asr::AssemblyInstanceFactory::create(
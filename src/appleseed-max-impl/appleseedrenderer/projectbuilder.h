@@ -48,12 +48,15 @@ namespace renderer { class ParamArray; }
 namespace renderer { class Project; }
 class Bitmap;
 class FrameRendParams;
+class GeometryCache;
+class MaterialCache;
 class MaxSceneEntities;
 class RendererSettings;
 class RendParams;
 class ViewParams;
 
 // Build an appleseed project from the current 3ds Max scene.
+// `geometry_cache` and `material_cache` are optional and may be nullptr.
 foundation::auto_release_ptr<renderer::Project> build_project(
     const MaxSceneEntities&             entities,
     const std::vector<DefaultLight>&    default_lights,
@@ -64,6 +67,8 @@ foundation::auto_release_ptr<renderer::Project> build_project(
     const RendererSettings&             settings,
     Bitmap*                             bitmap,
     const TimeValue                     time,
+    GeometryCache*                      geometry_cache,
+    MaterialCache*                      material_cache,
     RendProgressCallback*               progress_cb);
 
 #if MAX_RELEASE >= 18000
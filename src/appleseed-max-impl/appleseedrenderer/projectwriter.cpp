@@ -0,0 +1,281 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "projectwriter.h"
+
+// appleseed-max headers.
+#include "appleseedrenderer/meshconversion.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/log.h"
+#include "renderer/api/object.h"
+#include "renderer/api/project.h"
+#include "renderer/api/scene.h"
+
+// appleseed.foundation headers.
+#include "foundation/platform/types.h"
+#include "foundation/utility/string.h"
+
+// Boost headers.
+#include "boost/filesystem.hpp"
+#include "boost/system/error_code.hpp"
+
+// Standard headers.
+#include <cctype>
+#include <cstddef>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace asf = foundation;
+namespace asr = renderer;
+namespace bf = boost::filesystem;
+
+namespace
+{
+    const char* GeometryDirName = "geometry";
+
+    std::string make_mesh_name(const asf::uint64 hash)
+    {
+        std::stringstream sstr;
+        sstr << std::hex << std::setw(16) << std::setfill('0') << hash;
+        return sstr.str();
+    }
+
+    std::string make_mesh_filename(const asf::uint64 hash)
+    {
+        return make_mesh_name(hash) + ".binarymesh";
+    }
+
+    // Curve objects have no content hash: their files are named after the objects and
+    // written again every time the project is saved. Object names may contain characters
+    // that are not allowed in filenames, and filenames are not case-sensitive on Windows.
+    std::string make_curve_filename(
+        const std::string&              object_name,
+        std::set<std::string>&          curve_filenames)
+    {
+        std::string base_name = object_name;
+        for (auto& c : base_name)
+        {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_')
+                c = '_';
+        }
+
+        std::string filename = base_name + ".binarycurve";
+        for (size_t i = 2; !curve_filenames.insert(asf::lower_case(filename)).second; ++i)
+            filename = base_name + "_" + asf::to_string(i) + ".binarycurve";
+
+        return filename;
+    }
+
+    struct GeometryFileStats
+    {
+        size_t  m_written_file_count;
+        size_t  m_reused_file_count;
+        size_t  m_curve_file_count;
+
+        GeometryFileStats()
+          : m_written_file_count(0)
+          , m_reused_file_count(0)
+          , m_curve_file_count(0)
+        {
+        }
+    };
+
+    // A geometry file written for an object, and the parameter of the object that references it.
+    struct WrittenObject
+    {
+        asr::Object*    m_object;
+        const char*     m_param_name;
+    };
+
+    bool write_curve_file(
+        asr::CurveObject&               curve_object,
+        const bf::path&                 geometry_dir,
+        std::set<std::string>&          curve_filenames,
+        std::vector<WrittenObject>&     written_objects,
+        GeometryFileStats&              stats)
+    {
+        const std::string filename = make_curve_filename(curve_object.get_name(), curve_filenames);
+        const bf::path filepath = geometry_dir / filename;
+
+        if (!asr::CurveObjectWriter::write(curve_object, filepath.string().c_str()))
+        {
+            RENDERER_LOG_ERROR("failed to write curve file %s.", filepath.string().c_str());
+            return false;
+        }
+
+        ++stats.m_curve_file_count;
+
+        curve_object.get_parameters().insert("filepath", std::string(GeometryDirName) + "/" + filename);
+
+        WrittenObject written_object;
+        written_object.m_object = &curve_object;
+        written_object.m_param_name = "filepath";
+        written_objects.push_back(written_object);
+
+        return true;
+    }
+
+    bool write_mesh_file(
+        asr::MeshObject&                mesh_object,
+        const bf::path&                 geometry_dir,
+        std::vector<WrittenObject>&     written_objects,
+        GeometryFileStats&              stats)
+    {
+        // Files are shared by all objects with the same geometry, whatever their name.
+        const asf::uint64 hash = compute_content_hash(mesh_object);
+        const std::string filename = make_mesh_filename(hash);
+        const bf::path filepath = geometry_dir / filename;
+
+        boost::system::error_code ec;
+        if (bf::exists(filepath, ec))
+            ++stats.m_reused_file_count;
+        else
+        {
+            if (!asr::MeshObjectWriter::write(mesh_object, make_mesh_name(hash).c_str(), filepath.string().c_str()))
+            {
+                RENDERER_LOG_ERROR("failed to write mesh file %s.", filepath.string().c_str());
+                return false;
+            }
+
+            ++stats.m_written_file_count;
+        }
+
+        // Reference the file relatively to the project so that the project can be moved.
+        mesh_object.get_parameters().insert("filename", std::string(GeometryDirName) + "/" + filename);
+
+        WrittenObject written_object;
+        written_object.m_object = &mesh_object;
+        written_object.m_param_name = "filename";
+        written_objects.push_back(written_object);
+
+        return true;
+    }
+
+    // Since the project is written without its geometry files, every mesh and curve object must
+    // get a file here, otherwise the saved project would miss its geometry.
+    bool write_geometry_files(
+        asr::AssemblyContainer&         assemblies,
+        const bf::path&                 geometry_dir,
+        std::set<std::string>&          curve_filenames,
+        std::vector<WrittenObject>&     written_objects,
+        GeometryFileStats&              stats)
+    {
+        bool success = true;
+
+        for (auto& assembly : assemblies)
+        {
+            for (auto& object : assembly.objects())
+            {
+                asr::MeshObject* mesh_object = dynamic_cast<asr::MeshObject*>(&object);
+                asr::CurveObject* curve_object = dynamic_cast<asr::CurveObject*>(&object);
+
+                // Leave alone objects that already reference a geometry file.
+                if (mesh_object != nullptr && !object.get_parameters().strings().exist("filename"))
+                {
+                    if (!write_mesh_file(*mesh_object, geometry_dir, written_objects, stats))
+                        success = false;
+                }
+                else if (curve_object != nullptr && !object.get_parameters().strings().exist("filepath"))
+                {
+                    if (!write_curve_file(*curve_object, geometry_dir, curve_filenames, written_objects, stats))
+                        success = false;
+                }
+            }
+
+            if (!write_geometry_files(assembly.assemblies(), geometry_dir, curve_filenames, written_objects, stats))
+                success = false;
+        }
+
+        return success;
+    }
+}
+
+bool write_project(
+    asr::Project&                       project,
+    const char*                         filepath,
+    const bool                          binary_mesh_files)
+{
+    if (!binary_mesh_files)
+        return asr::ProjectFileWriter::write(project, filepath);
+
+    const bf::path geometry_dir = bf::absolute(filepath).parent_path() / GeometryDirName;
+
+    boost::system::error_code ec;
+    bf::create_directories(geometry_dir, ec);
+    if (ec)
+    {
+        RENDERER_LOG_ERROR(
+            "failed to create directory %s: %s.",
+            geometry_dir.string().c_str(),
+            ec.message().c_str());
+        return false;
+    }
+
+    std::set<std::string> curve_filenames;
+    std::vector<WrittenObject> written_objects;
+    GeometryFileStats stats;
+    bool success =
+        write_geometry_files(
+            project.get_scene()->assemblies(),
+            geometry_dir,
+            curve_filenames,
+            written_objects,
+            stats);
+
+    RENDERER_LOG_INFO(
+        "wrote %s binary mesh %s, reused %s unchanged %s.",
+        asf::pretty_uint(stats.m_written_file_count).c_str(),
+        asf::plural(stats.m_written_file_count, "file").c_str(),
+        asf::pretty_uint(stats.m_reused_file_count).c_str(),
+        asf::plural(stats.m_reused_file_count, "file").c_str());
+
+    if (stats.m_curve_file_count > 0)
+    {
+        RENDERER_LOG_INFO(
+            "wrote %s binary curve %s.",
+            asf::pretty_uint(stats.m_curve_file_count).c_str(),
+            asf::plural(stats.m_curve_file_count, "file").c_str());
+    }
+
+    if (!asr::ProjectFileWriter::write(
+            project,
+            filepath,
+            asr::ProjectFileWriter::OmitWritingGeometryFiles))
+        success = false;
+
+    // Objects stay in memory for rendering; drop the references to their files.
+    for (const auto& written_object : written_objects)
+        written_object.m_object->get_parameters().strings().remove(written_object.m_param_name);
+
+    return success;
+}
@@ -67,6 +67,7 @@ namespace
 
             m_output_mode = OutputMode::RenderOnly;
             m_scale_multiplier = 1.0f;
+            m_binary_mesh_files = false;
 
             m_rendering_threads = 0;    // 0 = as many as there are logical cores
             m_low_priority_mode = true;
@@ -78,6 +79,21 @@ namespace
 
             m_enable_render_stamp = false;
             m_render_stamp_format = L"appleseed {lib-version} | Time: {render-time}";
+
+            m_parallel_mesh_conversion = true;
+            m_weld_vertex_attributes = false;
+            m_weld_tolerance = 1.0e-5f;
+            m_cache_geometry = false;
+            m_optimize_meshes = false;
+            m_auto_instancing = false;
+            m_auto_assembly_instancing = false;
+            m_assembly_instancing_threshold = 1000000;
+            m_spline_curves = false;
+            m_motion_blur = false;
+            m_motion_samples = 2;
+            m_shutter_duration = 0.5f;
+            m_deformation_blur = false;
+            m_cache_materials = false;
         }
     };
 }
@@ -245,6 +261,10 @@ bool RendererSettings::save(ISave* isave) const
         success &= write<float>(isave, m_scale_multiplier);
         isave->EndChunk();
 
+        isave->BeginChunk(ChunkSettingsOutputBinaryMeshFiles);
+        success &= write<bool>(isave, m_binary_mesh_files);
+        isave->EndChunk();
+
     isave->EndChunk();
 
     //
@@ -275,6 +295,70 @@ bool RendererSettings::save(ISave* isave) const
         
     isave->EndChunk();
 
+    //
+    // Scene Export settings.
+    //
+
+    isave->BeginChunk(ChunkSettingsSceneExport);
+
+        isave->BeginChunk(ChunkSettingsSceneExportParallelMeshConv);
+        success &= write<bool>(isave, m_parallel_mesh_conversion);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSceneExportWeldVertexAttribs);
+        success &= write<bool>(isave, m_weld_vertex_attributes);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSceneExportWeldTolerance);
+        success &= write<float>(isave, m_weld_tolerance);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSceneExportCacheGeometry);
+        success &= write<bool>(isave, m_cache_geometry);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSceneExportOptimizeMeshes);
+        success &= write<bool>(isave, m_optimize_meshes);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSceneExportAutoInstancing);
+        success &= write<bool>(isave, m_auto_instancing);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSceneExportAutoAssemblyInst);
+        success &= write<bool>(isave, m_auto_assembly_instancing);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSceneExportAsmInstThreshold);
+        success &= write<int>(isave, m_assembly_instancing_threshold);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSceneExportSplineCurves);
+        success &= write<bool>(isave, m_spline_curves);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSceneExportMotionBlur);
+        success &= write<bool>(isave, m_motion_blur);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSceneExportMotionSamples);
+        success &= write<int>(isave, m_motion_samples);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSceneExportShutterDuration);
+        success &= write<float>(isave, m_shutter_duration);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSceneExportDeformationBlur);
+        success &= write<bool>(isave, m_deformation_blur);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSceneExportCacheMaterials);
+        success &= write<bool>(isave, m_cache_materials);
+        isave->EndChunk();
+
+    isave->EndChunk();
+
     return success;
 }
 
@@ -307,6 +391,10 @@ IOResult RendererSettings::load(ILoad* iload)
           case ChunkSettingsSystem:
             result = load_system_settings(iload);
             break;
+
+          case ChunkSettingsSceneExport:
+            result = load_scene_export_settings(iload);
+            break;
         }
 
         if (result != IO_OK)
@@ -470,6 +558,10 @@ IOResult RendererSettings::load_output_settings(ILoad* iload)
           case ChunkSettingsOutputScaleMultiplier:
             result = read(iload, &m_scale_multiplier);
             break;
+
+          case ChunkSettingsOutputBinaryMeshFiles:
+            result = read<bool>(iload, &m_binary_mesh_files);
+            break;
         }
 
         if (result != IO_OK)
@@ -528,3 +620,85 @@ IOResult RendererSettings::load_system_settings(ILoad* iload)
 
     return result;
 }
+
+IOResult RendererSettings::load_scene_export_settings(ILoad* iload)
+{
+    IOResult result = IO_OK;
+
+    while (true)
+    {
+        result = iload->OpenChunk();
+        if (result == IO_END)
+            return IO_OK;
+        if (result != IO_OK)
+            break;
+
+        switch (iload->CurChunkID())
+        {
+          case ChunkSettingsSceneExportParallelMeshConv:
+            result = read<bool>(iload, &m_parallel_mesh_conversion);
+            break;
+
+          case ChunkSettingsSceneExportWeldVertexAttribs:
+            result = read<bool>(iload, &m_weld_vertex_attributes);
+            break;
+
+          case ChunkSettingsSceneExportWeldTolerance:
+            result = read<float>(iload, &m_weld_tolerance);
+            break;
+
+          case ChunkSettingsSceneExportCacheGeometry:
+            result = read<bool>(iload, &m_cache_geometry);
+            break;
+
+          case ChunkSettingsSceneExportOptimizeMeshes:
+            result = read<bool>(iload, &m_optimize_meshes);
+            break;
+
+          case ChunkSettingsSceneExportAutoInstancing:
+            result = read<bool>(iload, &m_auto_instancing);
+            break;
+
+          case ChunkSettingsSceneExportAutoAssemblyInst:
+            result = read<bool>(iload, &m_auto_assembly_instancing);
+            break;
+
+          case ChunkSettingsSceneExportAsmInstThreshold:
+            result = read<int>(iload, &m_assembly_instancing_threshold);
+            break;
+
+          case ChunkSettingsSceneExportSplineCurves:
+            result = read<bool>(iload, &m_spline_curves);
+            break;
+
+          case ChunkSettingsSceneExportMotionBlur:
+            result = read<bool>(iload, &m_motion_blur);
+            break;
+
+          case ChunkSettingsSceneExportMotionSamples:
+            result = read<int>(iload, &m_motion_samples);
+            break;
+
+          case ChunkSettingsSceneExportShutterDuration:
+            result = read<float>(iload, &m_shutter_duration);
+            break;
+
+          case ChunkSettingsSceneExportDeformationBlur:
+            result = read<bool>(iload, &m_deformation_blur);
+            break;
+
+          case ChunkSettingsSceneExportCacheMaterials:
+            result = read<bool>(iload, &m_cache_materials);
+            break;
+        }
+
+        if (result != IO_OK)
+            break;
+
+        result = iload->CloseChunk();
+        if (result != IO_OK)
+            break;
+    }
+
+    return result;
+}
@@ -93,6 +93,7 @@ class RendererSettings
     OutputMode  m_output_mode;
     MSTR        m_project_file_path;
     float       m_scale_multiplier;
+    bool        m_binary_mesh_files;
 
     //
     // System.
@@ -106,6 +107,25 @@ class RendererSettings
     bool                        m_enable_render_stamp;
     MSTR                        m_render_stamp_format;
 
+    //
+    // Scene Export.
+    //
+
+    bool        m_parallel_mesh_conversion;
+    bool        m_weld_vertex_attributes;
+    float       m_weld_tolerance;
+    bool        m_cache_geometry;
+    bool        m_optimize_meshes;
+    bool        m_auto_instancing;
+    bool        m_auto_assembly_instancing;
+    int         m_assembly_instancing_threshold;
+    bool        m_spline_curves;
+    bool        m_motion_blur;
+    int         m_motion_samples;
+    float       m_shutter_duration;
+    bool        m_deformation_blur;
+    bool        m_cache_materials;
+
     // Apply these settings to a given project.
     void apply(renderer::Project& project) const;
 
@@ -120,6 +140,7 @@ class RendererSettings
     IOResult load_lighting_settings(ILoad* iload);
     IOResult load_output_settings(ILoad* iload);
     IOResult load_system_settings(ILoad* iload);
+    IOResult load_scene_export_settings(ILoad* iload);
 
     void apply_common_settings(renderer::Project& project, const char* config_name) const;
     void apply_settings_to_final_config(renderer::Project& project) const;
@@ -52,6 +52,7 @@
 #define IDC_STATIC_SCALE_MULTIPLIER                 407
 #define IDC_TEXT_SCALE_MULTIPLIER                   408
 #define IDC_SPINNER_SCALE_MULTIPLIER                409
+#define IDC_CHECK_BINARY_MESH_FILES                 410
 
 #define IDD_FORMVIEW_RENDERERPARAMS_SYSTEM          500
 #define IDC_TEXT_RENDERINGTHREADS                   501
@@ -71,6 +72,30 @@
 #define IDS_RENDERERPARAMS_LOG_OPEN_MODE_2          608
 #define IDS_RENDERERPARAMS_LOG_OPEN_MODE_3          609
 
+#define IDD_FORMVIEW_RENDERERPARAMS_SCENEEXPORT     700
+#define IDC_CHECK_PARALLEL_MESH_CONVERSION          701
+#define IDC_CHECK_WELD_VERTEX_ATTRIBUTES            702
+#define IDC_STATIC_WELD_TOLERANCE                   703
+#define IDC_TEXT_WELD_TOLERANCE                     704
+#define IDC_SPINNER_WELD_TOLERANCE                  705
+#define IDC_CHECK_CACHE_GEOMETRY                    706
+#define IDC_CHECK_OPTIMIZE_MESHES                   707
+#define IDC_CHECK_AUTO_INSTANCING                   708
+#define IDC_CHECK_AUTO_ASSEMBLY_INSTANCING          709
+#define IDC_STATIC_ASSEMBLY_INST_THRESHOLD          710
+#define IDC_TEXT_ASSEMBLY_INST_THRESHOLD            711
+#define IDC_SPINNER_ASSEMBLY_INST_THRESHOLD         712
+#define IDC_CHECK_SPLINE_CURVES                     713
+#define IDC_CHECK_MOTION_BLUR                       714
+#define IDC_STATIC_MOTION_SAMPLES                   715
+#define IDC_TEXT_MOTION_SAMPLES                     716
+#define IDC_SPINNER_MOTION_SAMPLES                  717
+#define IDC_STATIC_SHUTTER_DURATION                 718
+#define IDC_TEXT_SHUTTER_DURATION                   719
+#define IDC_SPINNER_SHUTTER_DURATION                720
+#define IDC_CHECK_DEFORMATION_BLUR                  721
+#define IDC_CHECK_CACHE_MATERIALS                   722
+
 // Next default values for new objects
 // 
 #ifdef APSTUDIO_INVOKED
@@ -35,6 +35,7 @@
 #include "appleseedsssmtl/resource.h"
 #include "bump/bumpparammapdlgproc.h"
 #include "bump/resource.h"
+#include "exprformatter.h"
 #include "main.h"
 #include "oslutils.h"
 #include "utilities.h"
@@ -701,19 +702,21 @@ asf::auto_release_ptr<asr::Material> AppleseedSSSMtl::create_osl_material(
         }
     }
 
-    shader_group->add_shader("surface", "as_max_sss_material", name, 
-        asr::ParamArray()
-            .insert("Radius", fmt_osl_expr(to_color3f(m_sss_scattering_color)))
-            .insert("SSSColor", fmt_osl_expr(to_color3f(m_sss_color)))
-            .insert("SpecularColor", fmt_osl_expr(to_color3f(m_specular_color)))
-            .insert("SpecularReflectance", fmt_osl_expr(m_specular_amount / 100.0f))
-            .insert("Roughness", fmt_osl_expr(m_specular_roughness / 100.0f))
-            .insert("Anisotropic", fmt_osl_expr(m_specular_anisotropy / 100.0f))
-            .insert("RadiusScale", fmt_osl_expr(m_sss_scale))
-            .insert("Profile", fmt_osl_expr("normalized_diffusion"))
-            .insert("SSSReflectance", fmt_osl_expr(m_sss_amount / 100.0f))
-            .insert("Distribution", fmt_osl_expr("ggx"))
-            .insert("Ior", fmt_osl_expr(m_sss_ior)));
+    // Each parameter is inserted before the next one is formatted: the formatter reuses its buffer.
+    ExprFormatter formatter;
+    asr::ParamArray surface_params;
+    surface_params.insert("Radius", formatter.osl(to_color3f(m_sss_scattering_color)));
+    surface_params.insert("SSSColor", formatter.osl(to_color3f(m_sss_color)));
+    surface_params.insert("SpecularColor", formatter.osl(to_color3f(m_specular_color)));
+    surface_params.insert("SpecularReflectance", formatter.osl(m_specular_amount / 100.0f));
+    surface_params.insert("Roughness", formatter.osl(m_specular_roughness / 100.0f));
+    surface_params.insert("Anisotropic", formatter.osl(m_specular_anisotropy / 100.0f));
+    surface_params.insert("RadiusScale", formatter.osl(m_sss_scale));
+    surface_params.insert("Profile", formatter.osl("normalized_diffusion"));
+    surface_params.insert("SSSReflectance", formatter.osl(m_sss_amount / 100.0f));
+    surface_params.insert("Distribution", formatter.osl("ggx"));
+    surface_params.insert("Ior", formatter.osl(m_sss_ior));
+    shader_group->add_shader("surface", "as_max_sss_material", name, surface_params);
 
     std::string closure2surface_name = asf::format("{0}_closure2surface", name);
     shader_group.ref().add_shader("shader", "as_max_closure2surface", closure2surface_name.c_str(), asr::ParamArray());
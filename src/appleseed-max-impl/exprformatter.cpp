@@ -0,0 +1,367 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "exprformatter.h"
+
+// Standard headers.
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+namespace asf = foundation;
+
+namespace
+{
+    // Write the first `precision` significant digits of a number d.ddd x 10^exponent the way
+    // the %g format would, with '.' as decimal separator: trailing zeros are removed, and an
+    // exponent is only used for very small or very large numbers. Return the number of
+    // characters written, terminator excluded.
+    size_t write_float(
+        char*           buffer,
+        const bool      negative,
+        const char*     digits,
+        const int       precision,
+        const int       exponent)
+    {
+        int digit_count = precision;
+        while (digit_count > 1 && digits[digit_count - 1] == '0')
+            --digit_count;
+
+        char* p = buffer;
+
+        if (negative)
+            *p++ = '-';
+
+        if (exponent < -4 || exponent >= precision)
+        {
+            *p++ = digits[0];
+            if (digit_count > 1)
+            {
+                *p++ = '.';
+                for (int i = 1; i < digit_count; ++i)
+                    *p++ = digits[i];
+            }
+
+            *p++ = 'e';
+            *p++ = exponent < 0 ? '-' : '+';
+            const int magnitude = exponent < 0 ? -exponent : exponent;
+            *p++ = static_cast<char>('0' + magnitude / 10);
+            *p++ = static_cast<char>('0' + magnitude % 10);
+        }
+        else if (exponent >= 0)
+        {
+            for (int i = 0; i <= exponent; ++i)
+                *p++ = i < digit_count ? digits[i] : '0';
+
+            if (digit_count > exponent + 1)
+            {
+                *p++ = '.';
+                for (int i = exponent + 1; i < digit_count; ++i)
+                    *p++ = digits[i];
+            }
+        }
+        else
+        {
+            *p++ = '0';
+            *p++ = '.';
+            for (int i = -1; i > exponent; --i)
+                *p++ = '0';
+            for (int i = 0; i < digit_count; ++i)
+                *p++ = digits[i];
+        }
+
+        *p = '\0';
+
+        return static_cast<size_t>(p - buffer);
+    }
+
+    // Powers of 10 that are exactly representable by doubles.
+    const double ExactPowersOf10[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const int MaxExactPowerOf10 = 22;
+
+    // Return true if the number written by write_float() from the same digits reads back to
+    // `value`. `s` is that number, with '.' as decimal separator.
+    bool reads_back(
+        const char*     s,
+        const char*     digits,
+        const int       precision,
+        const int       exponent,
+        const float     value)
+    {
+        // When both the digits and the power of 10 are exact doubles, a single multiplication
+        // or division rounds the number like std::strtod() would.
+        const int scale = exponent - (precision - 1);
+        if (scale >= -MaxExactPowerOf10 && scale <= MaxExactPowerOf10)
+        {
+            double mantissa = 0.0;
+            for (int i = 0; i < precision; ++i)
+                mantissa = mantissa * 10.0 + (digits[i] - '0');
+
+            const double magnitude =
+                scale >= 0
+                    ? mantissa * ExactPowersOf10[scale]
+                    : mantissa / ExactPowersOf10[-scale];
+
+            return std::abs(value) == static_cast<float>(magnitude);
+        }
+
+        // std::strtod() honors the current locale, OSL and SeExpr don't.
+        const char decimal_point = *std::localeconv()->decimal_point;
+        if (decimal_point == '.')
+            return static_cast<float>(std::strtod(s, nullptr)) == value;
+
+        char localized[NumberStringCapacity];
+        size_t i = 0;
+        for (; s[i] != '\0'; ++i)
+            localized[i] = s[i] == '.' ? decimal_point : s[i];
+        localized[i] = '\0';
+
+        return static_cast<float>(std::strtod(localized, nullptr)) == value;
+    }
+}
+
+size_t format_float(char* buffer, const float value)
+{
+    // Infinities and NaNs.
+    if (!(std::abs(value) <= std::numeric_limits<float>::max()))
+        return static_cast<size_t>(_snprintf_s(buffer, NumberStringCapacity, _TRUNCATE, "%g", value));
+
+    // 9 significant digits always read back to the same float. Print them once, in the
+    // form [-]d.dddddddde[+-]xx, then try shorter representations rounded from these digits.
+    char scientific[NumberStringCapacity];
+    _snprintf_s(scientific, NumberStringCapacity, _TRUNCATE, "%.8e", value);
+
+    const bool negative = scientific[0] == '-';
+    const char* mantissa = scientific + (negative ? 1 : 0);
+
+    char digits[9];
+    digits[0] = mantissa[0];
+    for (int i = 1; i < 9; ++i)
+        digits[i] = mantissa[i + 1];            // skip the decimal separator of the current locale
+    const int exponent = std::atoi(mantissa + 11);
+
+    // A float rounded to 6 significant digits only has trailing zeros if fewer digits are
+    // enough. Candidates are rounded from the 9 digits above rather than from the exact value,
+    // so they are checked by reading them back, usually without parsing them.
+    for (int precision = 6; precision < 9; ++precision)
+    {
+        char rounded[9];
+        int rounded_exponent = exponent;
+        for (int i = 0; i < precision; ++i)
+            rounded[i] = digits[i];
+
+        if (digits[precision] >= '5')
+        {
+            int i = precision - 1;
+            while (i >= 0 && rounded[i] == '9')
+                rounded[i--] = '0';
+
+            if (i >= 0)
+                ++rounded[i];
+            else
+            {
+                rounded[0] = '1';
+                ++rounded_exponent;
+            }
+        }
+
+        const size_t length = write_float(buffer, negative, rounded, precision, rounded_exponent);
+        if (reads_back(buffer, rounded, precision, rounded_exponent, value))
+            return length;
+    }
+
+    return write_float(buffer, negative, digits, 9, exponent);
+}
+
+size_t format_int(char* buffer, const int value)
+{
+    // Write digits backward from the end of a temporary buffer.
+    char digits[NumberStringCapacity];
+    char* p = digits + NumberStringCapacity;
+
+    unsigned int magnitude =
+        value < 0
+            ? 0u - static_cast<unsigned int>(value)
+            : static_cast<unsigned int>(value);
+
+    do
+    {
+        *--p = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    if (value < 0)
+        *--p = '-';
+
+    const size_t length = static_cast<size_t>(digits + NumberStringCapacity - p);
+    for (size_t i = 0; i < length; ++i)
+        buffer[i] = p[i];
+    buffer[length] = '\0';
+
+    return length;
+}
+
+
+//
+// ExprFormatter class implementation.
+//
+
+const char* ExprFormatter::osl(const char* s)
+{
+    m_buffer.clear();
+    append("string ");
+    append(s);
+    return m_buffer.c_str();
+}
+
+const char* ExprFormatter::osl(const std::string& s)
+{
+    m_buffer.clear();
+    append("string ");
+    append(s);
+    return m_buffer.c_str();
+}
+
+const char* ExprFormatter::osl(const int value)
+{
+    m_buffer.clear();
+    append("int ");
+    append(value);
+    return m_buffer.c_str();
+}
+
+const char* ExprFormatter::osl(const float value)
+{
+    m_buffer.clear();
+    append("float ");
+    append(value);
+    return m_buffer.c_str();
+}
+
+const char* ExprFormatter::osl(const asf::Color3f& linear_rgb)
+{
+    append_triple("color ", linear_rgb.r, linear_rgb.g, linear_rgb.b);
+    return m_buffer.c_str();
+}
+
+const char* ExprFormatter::osl(const asf::Vector3f& vector)
+{
+    append_triple("vector ", vector.x, vector.y, vector.z);
+    return m_buffer.c_str();
+}
+
+const char* ExprFormatter::osl_normal(const asf::Vector3f& normal)
+{
+    append_triple("normal ", normal.x, normal.y, normal.z);
+    return m_buffer.c_str();
+}
+
+const char* ExprFormatter::osl_point(const asf::Vector3f& point)
+{
+    append_triple("point ", point.x, point.y, point.z);
+    return m_buffer.c_str();
+}
+
+const char* ExprFormatter::se(const asf::Color3f& srgb)
+{
+    m_buffer.clear();
+    append("[");
+    append(srgb.r);
+    append(", ");
+    append(srgb.g);
+    append(", ");
+    append(srgb.b);
+    append("]");
+    return m_buffer.c_str();
+}
+
+const char* ExprFormatter::se_texture(const std::string& filepath, const int width, const int height)
+{
+    m_buffer.clear();
+    append("texture(\"");
+    append(filepath);
+    append("\", $u % ");
+    append(width);
+    append(", $v % ");
+    append(height);
+    append(")");
+    return m_buffer.c_str();
+}
+
+const char* ExprFormatter::se_product(const float scalar, const char* expr)
+{
+    m_buffer.clear();
+    append(scalar);
+    if (expr != nullptr && *expr != '\0')
+    {
+        append(" * ");
+        append(expr);
+    }
+    return m_buffer.c_str();
+}
+
+void ExprFormatter::append(const char* s)
+{
+    m_buffer.append(s);
+}
+
+void ExprFormatter::append(const std::string& s)
+{
+    m_buffer.append(s);
+}
+
+void ExprFormatter::append(const int value)
+{
+    char buffer[NumberStringCapacity];
+    m_buffer.append(buffer, format_int(buffer, value));
+}
+
+void ExprFormatter::append(const float value)
+{
+    char buffer[NumberStringCapacity];
+    m_buffer.append(buffer, format_float(buffer, value));
+}
+
+void ExprFormatter::append_triple(const char* type, const float x, const float y, const float z)
+{
+    m_buffer.clear();
+    append(type);
+    append(x);
+    append(" ");
+    append(y);
+    append(" ");
+    append(z);
+}
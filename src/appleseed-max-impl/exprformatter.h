@@ -0,0 +1,86 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/image/color.h"
+#include "foundation/math/vector.h"
+
+// Standard headers.
+#include <cstddef>
+#include <string>
+
+//
+// Formats OSL and SeExpr parameter expressions into a buffer whose storage is reused from one
+// expression to the next. Returned pointers remain valid until the next call.
+//
+// Numbers are written with the shortest representation that reads back to the same value, and
+// with '.' as decimal separator whatever the current locale.
+//
+
+class ExprFormatter
+  : public foundation::NonCopyable
+{
+  public:
+    // OSL expressions, see fmt_osl_expr() and friends.
+    const char* osl(const char* s);
+    const char* osl(const std::string& s);
+    const char* osl(const int value);
+    const char* osl(const float value);
+    const char* osl(const foundation::Color3f& linear_rgb);
+    const char* osl(const foundation::Vector3f& vector);
+    const char* osl_normal(const foundation::Vector3f& normal);
+    const char* osl_point(const foundation::Vector3f& point);
+
+    // SeExpr expressions, see fmt_se_expr().
+    const char* se(const foundation::Color3f& srgb);
+    const char* se_texture(const std::string& filepath, const int width, const int height);
+    const char* se_product(const float scalar, const char* expr);
+
+  private:
+    std::string m_buffer;
+
+    void append(const char* s);
+    void append(const std::string& s);
+    void append(const int value);
+    void append(const float value);
+    void append_triple(const char* type, const float x, const float y, const float z);
+};
+
+// Maximum number of characters written by format_float() and format_int(), terminator included.
+const size_t NumberStringCapacity = 32;
+
+// Write the shortest representation of `value` that reads back to the same float, with '.' as
+// decimal separator. Return the number of characters written, terminator excluded.
+size_t format_float(char* buffer, const float value);
+
+// Write the decimal representation of `value`. Return the number of characters written,
+// terminator excluded.
+size_t format_int(char* buffer, const int value);
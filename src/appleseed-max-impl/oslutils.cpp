@@ -33,6 +33,7 @@
 #include "appleseedoslplugin/oslshadermetadata.h"
 #include "appleseedoslplugin/osltexture.h"
 #include "builtinmapsupport.h"
+#include "exprformatter.h"
 #include "iappleseedmtl.h"
 #include "utilities.h"
 
@@ -51,12 +52,132 @@
 #include <stdmat.h>
 #include <iparamm2.h>
 
+// Standard headers.
+#include <cstddef>
+#include <functional>
+#include <set>
+
 namespace asf = foundation;
 namespace asr = renderer;
 
+namespace
+{
+    // Layers reading a bitmap texture are named after the texture and the parameters they
+    // depend on. Material inputs using the same texture find these layers in the shader group
+    // and connect to them instead of adding their own copies.
+
+    size_t hash_params(Texmap* texmap, const asr::ParamArray& params)
+    {
+        std::string key = asf::to_string(static_cast<const void*>(texmap));
+
+        const asf::StringDictionary& strings = params.strings();
+        for (auto it = strings.begin(), e = strings.end(); it != e; ++it)
+        {
+            key += ';';
+            key += it.key();
+            key += '=';
+            key += it.value();
+        }
+
+        return std::hash<std::string>()(key);
+    }
+
+    bool has_layer(const asr::ShaderGroup& shader_group, const std::string& layer_name)
+    {
+        return shader_group.shaders().get_by_name(layer_name.c_str()) != nullptr;
+    }
+
+    // Add to a shader group, unless it already has them, the UV transform layer of a bitmap
+    // texture and a texture layer using a given shader. Return the name of the texture layer.
+    std::string add_bitmap_texture_layers(
+        asr::ShaderGroup&   shader_group,
+        Texmap*             texmap,
+        const char*         texture_shader_name)
+    {
+        const asr::ParamArray uv_params = get_uv_params(texmap);
+        const std::string base_layer_name =
+            asf::format(
+                "{0}_{1}",
+                wide_to_utf8(texmap->GetName().data()),
+                hash_params(texmap, uv_params));
+
+        const auto uv_transform_layer_name = base_layer_name + "_uv_transform";
+        if (!has_layer(shader_group, uv_transform_layer_name))
+            shader_group.add_shader("shader", "as_max_uv_transform", uv_transform_layer_name.c_str(), uv_params);
+
+        const auto texture_layer_name = asf::format("{0}_{1}", base_layer_name, texture_shader_name);
+        if (!has_layer(shader_group, texture_layer_name))
+        {
+            shader_group.add_shader("shader", texture_shader_name, texture_layer_name.c_str(),
+                asr::ParamArray()
+                    .insert("Filename", fmt_osl_expr(texmap)));
+
+            shader_group.add_connection(
+                uv_transform_layer_name.c_str(), "out_U",
+                texture_layer_name.c_str(), "U");
+
+            shader_group.add_connection(
+                uv_transform_layer_name.c_str(), "out_V",
+                texture_layer_name.c_str(), "V");
+        }
+
+        return texture_layer_name;
+    }
+
+    // Add to a shader group, unless it already has it, a layer converting the output of a
+    // given layer from sRGB to linear RGB. Return the name of the new layer.
+    std::string add_srgb_to_linear_layer(
+        asr::ShaderGroup&   shader_group,
+        const std::string&  color_layer_name)
+    {
+        const auto layer_name = color_layer_name + "_srgb_to_linear";
+        if (!has_layer(shader_group, layer_name))
+        {
+            shader_group.add_shader("shader", "as_max_srgb_to_linear_rgb", layer_name.c_str(),
+                asr::ParamArray());
+
+            shader_group.add_connection(
+                color_layer_name.c_str(), "ColorOut",
+                layer_name.c_str(), "ColorIn");
+        }
+
+        return layer_name;
+    }
+
+    // Add to a shader group, unless it already has it, a color balance layer applying the
+    // output parameters of a bitmap texture to the output of a given layer. Return the
+    // name of the new layer.
+    std::string add_color_balance_layer(
+        asr::ShaderGroup&       shader_group,
+        Texmap*                 texmap,
+        const asr::ParamArray&  color_balance_params,
+        const std::string&      input_layer_name,
+        const char*             input_layer_output,
+        const char*             color_balance_input)
+    {
+        const auto layer_name =
+            asf::format(
+                "{0}_color_balance_{1}",
+                input_layer_name,
+                hash_params(texmap, color_balance_params));
+
+        if (!has_layer(shader_group, layer_name))
+        {
+            shader_group.add_shader("shader", "as_max_color_balance", layer_name.c_str(), color_balance_params);
+
+            shader_group.add_connection(
+                input_layer_name.c_str(), input_layer_output,
+                layer_name.c_str(), color_balance_input);
+        }
+
+        return layer_name;
+    }
+}
+
 asr::ParamArray get_uv_params(Texmap* texmap)
 {
     asr::ParamArray uv_params;
+    ExprFormatter formatter;
 
     if (texmap == nullptr)
         return uv_params;
@@ -79,22 +200,22 @@ asr::ParamArray get_uv_params(Texmap* texmap)
     int tiling = std_uv->GetTextureTiling();
 
     if (tiling & U_WRAP)
-        uv_params.insert("in_wrapU", fmt_osl_expr(1));
+        uv_params.insert("in_wrapU", formatter.osl(1));
     else if (tiling & U_MIRROR)
-        uv_params.insert("in_mirrorU", fmt_osl_expr(1));
+        uv_params.insert("in_mirrorU", formatter.osl(1));
 
     if (tiling & V_WRAP)
-        uv_params.insert("in_wrapV", fmt_osl_expr(1));
+        uv_params.insert("in_wrapV", formatter.osl(1));
     else if (tiling & V_MIRROR)
-        uv_params.insert("in_mirrorV", fmt_osl_expr(1));
+        uv_params.insert("in_mirrorV", formatter.osl(1));
 
-    uv_params.insert("in_offsetU", fmt_osl_expr(u_offset));
-    uv_params.insert("in_offsetV", fmt_osl_expr(v_offset));
+    uv_params.insert("in_offsetU", formatter.osl(u_offset));
+    uv_params.insert("in_offsetV", formatter.osl(v_offset));
 
-    uv_params.insert("in_tilingU", fmt_osl_expr(u_tiling));
-    uv_params.insert("in_tilingV", fmt_osl_expr(v_tiling));
+    uv_params.insert("in_tilingU", formatter.osl(u_tiling));
+    uv_params.insert("in_tilingV", formatter.osl(v_tiling));
 
-    uv_params.insert("in_rotateW", fmt_osl_expr(asf::rad_to_deg(w_rotation)));
+    uv_params.insert("in_rotateW", formatter.osl(asf::rad_to_deg(w_rotation)));
 
     // Access BMTex parameters through parameter block.
     enum
@@ -129,19 +250,19 @@ asr::ParamArray get_uv_params(Texmap* texmap)
 
             const int crop_place = pblock->GetInt(bmtex_crop_place, time, FOREVER);
 
-            uv_params.insert("in_cropU", fmt_osl_expr(clip_u));
-            uv_params.insert("in_cropV", fmt_osl_expr(clip_v));
+            uv_params.insert("in_cropU", formatter.osl(clip_u));
+            uv_params.insert("in_cropV", formatter.osl(clip_v));
 
-            uv_params.insert("in_cropW", fmt_osl_expr(clip_w));
-            uv_params.insert("in_cropH", fmt_osl_expr(clip_h));
+            uv_params.insert("in_cropW", formatter.osl(clip_w));
+            uv_params.insert("in_cropH", formatter.osl(clip_h));
 
             if (crop_place)
-                uv_params.insert("in_crop_mode", fmt_osl_expr("place"));
+                uv_params.insert("in_crop_mode", formatter.osl("place"));
             else
-                uv_params.insert("in_crop_mode", fmt_osl_expr("crop"));
+                uv_params.insert("in_crop_mode", formatter.osl("crop"));
         }
         else
-            uv_params.insert("in_crop_mode", fmt_osl_expr("off"));
+            uv_params.insert("in_crop_mode", formatter.osl("off"));
     }
 
     return uv_params;
@@ -151,14 +272,15 @@ asr::ParamArray get_uv_params(Texmap* texmap)
 asr::ParamArray get_output_params(Texmap* texmap)
 {
     asr::ParamArray output_params;
-    output_params.insert("in_multiplier", fmt_osl_expr(1.0f));
-    output_params.insert("in_clamp_output", fmt_osl_expr(0));
-    output_params.insert("in_invert", fmt_osl_expr(0));
-    output_params.insert("in_colorGain", fmt_osl_expr(foundation::Color3f(1.0f)));
-    output_params.insert("in_colorOffset", fmt_osl_expr(foundation::Color3f(0.0f)));
-    output_params.insert("in_alphaGain", fmt_osl_expr(1.0f));
-    output_params.insert("in_alphaOffset", fmt_osl_expr(0.0f));
-    output_params.insert("in_alphaIsLuminance", fmt_osl_expr(0));
+    ExprFormatter formatter;
+    output_params.insert("in_multiplier", formatter.osl(1.0f));
+    output_params.insert("in_clamp_output", formatter.osl(0));
+    output_params.insert("in_invert", formatter.osl(0));
+    output_params.insert("in_colorGain", formatter.osl(foundation::Color3f(1.0f)));
+    output_params.insert("in_colorOffset", formatter.osl(foundation::Color3f(0.0f)));
+    output_params.insert("in_alphaGain", formatter.osl(1.0f));
+    output_params.insert("in_alphaOffset", formatter.osl(0.0f));
+    output_params.insert("in_alphaIsLuminance", formatter.osl(0));
 
     if (texmap == nullptr)
         return output_params;
@@ -179,51 +301,58 @@ asr::ParamArray get_output_params(Texmap* texmap)
 
     const auto time = GetCOREInterface()->GetTime();
 
-    output_params.insert("in_multiplier", fmt_osl_expr(std_tex_output->GetOutAmt(time)));
-    output_params.insert("in_clamp_output", fmt_osl_expr(std_tex_output->GetClamp()));
-    output_params.insert("in_invert", fmt_osl_expr(std_tex_output->GetInvert()));
-    output_params.insert("in_colorGain", fmt_osl_expr(foundation::Color3f(std_tex_output->GetRGBAmt(time))));
-    output_params.insert("in_colorOffset", fmt_osl_expr(foundation::Color3f(std_tex_output->GetRGBOff(time))));
-    output_params.insert("in_alphaGain", fmt_osl_expr(std_tex_output->GetRGBAmt(time)));
-    output_params.insert("in_alphaOffset", fmt_osl_expr(std_tex_output->GetRGBOff(time)));
-    output_params.insert("in_alphaIsLuminance", fmt_osl_expr(std_tex_output->GetAlphaFromRGB()));
+    output_params.insert("in_multiplier", formatter.osl(std_tex_output->GetOutAmt(time)));
+    output_params.insert("in_clamp_output", formatter.osl(std_tex_output->GetClamp()));
+    output_params.insert("in_invert", formatter.osl(std_tex_output->GetInvert()));
+    output_params.insert("in_colorGain", formatter.osl(foundation::Color3f(std_tex_output->GetRGBAmt(time))));
+    output_params.insert("in_colorOffset", formatter.osl(foundation::Color3f(std_tex_output->GetRGBOff(time))));
+    output_params.insert("in_alphaGain", formatter.osl(std_tex_output->GetRGBAmt(time)));
+    output_params.insert("in_alphaOffset", formatter.osl(std_tex_output->GetRGBOff(time)));
+    output_params.insert("in_alphaIsLuminance", formatter.osl(std_tex_output->GetAlphaFromRGB()));
 
     return output_params;
 }
 
 std::string fmt_osl_expr(const std::string& s)
 {
-    return asf::format("string {0}", s);
+    ExprFormatter formatter;
+    return formatter.osl(s);
 }
 
 std::string fmt_osl_expr(const int value)
 {
-    return asf::format("int {0}", value);
+    ExprFormatter formatter;
+    return formatter.osl(value);
 }
 
 std::string fmt_osl_expr(const float value)
 {
-    return asf::format("float {0}", value);
+    ExprFormatter formatter;
+    return formatter.osl(value);
 }
 
 std::string fmt_osl_expr(const asf::Color3f& linear_rgb)
 {
-    return asf::format("color {0} {1} {2}", linear_rgb.r, linear_rgb.g, linear_rgb.b);
+    ExprFormatter formatter;
+    return formatter.osl(linear_rgb);
 }
 
 std::string fmt_osl_expr(const asf::Vector3f& vector)
 {
-    return asf::format("vector {0} {1} {2}", vector.x, vector.y, vector.z);
+    ExprFormatter formatter;
+    return formatter.osl(vector);
 }
 
 std::string fmt_osl_normal_expr(const asf::Vector3f& normal)
 {
-    return asf::format("normal {0} {1} {2}", normal.x, normal.y, normal.z);
+    ExprFormatter formatter;
+    return formatter.osl_normal(normal);
 }
 
 std::string fmt_osl_point_expr(const asf::Vector3f& point)
 {
-    return asf::format("point {0} {1} {2}", point.x, point.y, point.z);
+    ExprFormatter formatter;
+    return formatter.osl_point(point);
 }
 
 std::string fmt_osl_expr(Texmap* texmap)
@@ -258,31 +387,20 @@ void connect_float_texture(
 
     if (is_bitmap_texture(texmap))
     {
-        const auto uv_transform_layer_name = asf::format("{0}_{1}_uv_transform", material_node_name, material_input_name);
-        shader_group.add_shader("shader", "as_max_uv_transform", uv_transform_layer_name.c_str(), get_uv_params(texmap));
-
-        const auto layer_name = asf::format("{0}_{1}_texture", material_node_name, material_input_name);
-        shader_group.add_shader("shader", "as_max_float_texture", layer_name.c_str(),
-            asr::ParamArray()
-                .insert("Filename", fmt_osl_expr(texmap)));
+        const auto texture_layer_name =
+            add_bitmap_texture_layers(shader_group, texmap, "as_max_float_texture");
 
         asr::ParamArray color_balance_params = get_output_params(texmap)
             .insert("in_constantFloat", fmt_osl_expr(const_value));
 
-        const auto color_balance_layer_name = asf::format("{0}_{1}_color_balance", material_node_name, material_input_name);
-        shader_group.add_shader("shader", "as_max_color_balance", color_balance_layer_name.c_str(), color_balance_params);
-
-        shader_group.add_connection(
-            uv_transform_layer_name.c_str(), "out_U",
-            layer_name.c_str(), "U");
-
-        shader_group.add_connection(
-            uv_transform_layer_name.c_str(), "out_V",
-            layer_name.c_str(), "V");
-
-        shader_group.add_connection(
-            layer_name.c_str(), "FloatOut",
-            color_balance_layer_name.c_str(), "in_defaultFloat");
+        const auto color_balance_layer_name =
+            add_color_balance_layer(
+                shader_group,
+                texmap,
+                color_balance_params,
+                texture_layer_name,
+                "FloatOut",
+                "in_defaultFloat");
 
         shader_group.add_connection(
             color_balance_layer_name.c_str(), "out_outAlpha",
@@ -312,74 +430,27 @@ void connect_color_texture(
     
     if (is_bitmap_texture(texmap))
     {
-        const auto uv_transform_layer_name = asf::format("{0}_{1}_uv_transform", material_node_name, material_input_name);
-        shader_group.add_shader("shader", "as_max_uv_transform", uv_transform_layer_name.c_str(), get_uv_params(texmap));
-        if (!is_linear_texture(static_cast<BitmapTex*>(texmap)))
-        {
-            const auto texture_layer_name = asf::format("{0}_{1}_texture", material_node_name, material_input_name);
-            shader_group.add_shader("shader", "as_max_color_texture", texture_layer_name.c_str(),
-                asr::ParamArray()
-                    .insert("Filename", fmt_osl_expr(texmap)));
-
-            const auto srgb_to_linear_layer_name = asf::format("{0}_{1}_srgb_to_linear", material_node_name, material_input_name);
-            shader_group.add_shader("shader", "as_max_srgb_to_linear_rgb", srgb_to_linear_layer_name.c_str(),
-                asr::ParamArray());
-
-            asr::ParamArray color_balance_params = get_output_params(texmap)
-                .insert("in_constantColor", fmt_osl_expr(to_color3f(const_color)));
-
-            const auto color_balance_layer_name = asf::format("{0}_{1}_color_balance", material_node_name, material_input_name);
-            shader_group.add_shader("shader", "as_max_color_balance", color_balance_layer_name.c_str(), color_balance_params);
-
-            shader_group.add_connection(
-                uv_transform_layer_name.c_str(), "out_U",
-                texture_layer_name.c_str(), "U");
-
-            shader_group.add_connection(
-                uv_transform_layer_name.c_str(), "out_V",
-                texture_layer_name.c_str(), "V");
-
-            shader_group.add_connection(
-                texture_layer_name.c_str(), "ColorOut",
-                srgb_to_linear_layer_name.c_str(), "ColorIn");
-
-            shader_group.add_connection(
-                srgb_to_linear_layer_name.c_str(), "ColorOut",
-                color_balance_layer_name.c_str(), "in_defaultColor");
-
-            shader_group.add_connection(
-                color_balance_layer_name.c_str(), "out_outColor",
-                material_node_name, material_input_name);
-        }
-        else
-        {
-            const auto texture_layer_name = asf::format("{0}_{1}_texture", material_node_name, material_input_name);
-            shader_group.add_shader("shader", "as_max_color_texture", texture_layer_name.c_str(),
-                asr::ParamArray()
-                    .insert("Filename", fmt_osl_expr(texmap)));
-
-            asr::ParamArray color_balance_params = get_output_params(texmap)
-                .insert("in_constantColor", fmt_osl_expr(to_color3f(const_color)));
-
-            const auto color_balance_layer_name = asf::format("{0}_{1}_color_balance", material_node_name, material_input_name);
-            shader_group.add_shader("shader", "as_max_color_balance", color_balance_layer_name.c_str(), color_balance_params);
+        std::string color_layer_name =
+            add_bitmap_texture_layers(shader_group, texmap, "as_max_color_texture");
 
-            shader_group.add_connection(
-                uv_transform_layer_name.c_str(), "out_U",
-                texture_layer_name.c_str(), "U");
+        if (!is_linear_texture(static_cast<BitmapTex*>(texmap)))
+            color_layer_name = add_srgb_to_linear_layer(shader_group, color_layer_name);
 
-            shader_group.add_connection(
-                uv_transform_layer_name.c_str(), "out_V",
-                texture_layer_name.c_str(), "V");
+        asr::ParamArray color_balance_params = get_output_params(texmap)
+            .insert("in_constantColor", fmt_osl_expr(to_color3f(const_color)));
 
-            shader_group.add_connection(
-                texture_layer_name.c_str(), "ColorOut",
-                color_balance_layer_name.c_str(), "in_defaultColor");
+        const auto color_balance_layer_name =
+            add_color_balance_layer(
+                shader_group,
+                texmap,
+                color_balance_params,
+                color_layer_name,
+                "ColorOut",
+                "in_defaultColor");
 
-            shader_group.add_connection(
-                color_balance_layer_name.c_str(), "out_outColor",
-                material_node_name, material_input_name);
-        }
+        shader_group.add_connection(
+            color_balance_layer_name.c_str(), "out_outColor",
+            material_node_name, material_input_name);
     }
 }
 
@@ -415,27 +486,14 @@ void connect_bump_map(
 
     if (is_bitmap_texture(texmap))
     {
-        auto uv_transform_layer_name = asf::format("{0}_bump_uv_transform", material_node_name);
-        shader_group.add_shader("shader", "as_max_uv_transform", uv_transform_layer_name.c_str(), get_uv_params(texmap));
-
-        auto texture_layer_name = asf::format("{0}_bump_map_texture", material_node_name);
-        shader_group.add_shader("shader", "as_max_float_texture", texture_layer_name.c_str(),
-            asr::ParamArray()
-                .insert("Filename", fmt_osl_expr(texmap)));
+        const auto texture_layer_name =
+            add_bitmap_texture_layers(shader_group, texmap, "as_max_float_texture");
 
         auto bump_map_layer_name = asf::format("{0}_bump_map", material_node_name);
         shader_group.add_shader("shader", "as_max_bump_map", bump_map_layer_name.c_str(),
             asr::ParamArray()
                 .insert("Amount", fmt_osl_expr(amount)));
 
-        shader_group.add_connection(
-            uv_transform_layer_name.c_str(), "out_U",
-            texture_layer_name.c_str(), "U");
-
-        shader_group.add_connection(
-            uv_transform_layer_name.c_str(), "out_V",
-            texture_layer_name.c_str(), "V");
-
         shader_group.add_connection(
             texture_layer_name.c_str(), "FloatOut",
             bump_map_layer_name.c_str(), "Height");
@@ -482,13 +540,8 @@ void connect_normal_map(
 
     if (is_bitmap_texture(texmap))
     {
-        auto uv_transform_layer_name = asf::format("{0}_bump_uv_transform", material_node_name);
-        shader_group.add_shader("shader", "as_max_uv_transform", uv_transform_layer_name.c_str(), get_uv_params(texmap));
-
-        auto texture_layer_name = asf::format("{0}_normal_map_texture", material_node_name);
-        shader_group.add_shader("shader", "as_max_color_texture", texture_layer_name.c_str(),
-            asr::ParamArray()
-                .insert("Filename", fmt_osl_expr(texmap)));
+        const auto texture_layer_name =
+            add_bitmap_texture_layers(shader_group, texmap, "as_max_color_texture");
 
         auto normal_map_layer_name = asf::format("{0}_normal_map", material_node_name);
         shader_group.add_shader("shader", "as_max_normal_map", normal_map_layer_name.c_str(),
@@ -496,14 +549,6 @@ void connect_normal_map(
                 .insert("UpVector", fmt_osl_expr(up_vector == 0 ? "Green" : "Blue"))
                 .insert("Amount", fmt_osl_expr(amount)));
 
-        shader_group.add_connection(
-            uv_transform_layer_name.c_str(), "out_U",
-            texture_layer_name.c_str(), "U");
-
-        shader_group.add_connection(
-            uv_transform_layer_name.c_str(), "out_V",
-            texture_layer_name.c_str(), "V");
-
         shader_group.add_connection(
             texture_layer_name.c_str(), "ColorOut",
             normal_map_layer_name.c_str(), "Color");
@@ -527,6 +572,15 @@ void connect_sub_mtl(
     if (!appleseed_mtl)
         return;
 
+    // Connect to the layers of this sub-material if they were already built into the shader group.
+    SubMaterialLayerRegistry* registry = SubMaterialLayerRegistry::current();
+    std::string sub_mtl_layer, sub_mtl_output;
+    if (registry != nullptr && registry->find(shader_group, mat, sub_mtl_layer, sub_mtl_output))
+    {
+        shader_group.add_connection(sub_mtl_layer.c_str(), sub_mtl_output.c_str(), shader_name, shader_input);
+        return;
+    }
+
     std::string layer_name =
         make_unique_name(assembly.materials(), asf::format("{0}_{1}_sub_mat", shader_name, mat->GetName()));
     assembly.materials().insert(appleseed_mtl->create_material(assembly, layer_name.c_str(), false));
@@ -538,19 +592,35 @@ void connect_sub_mtl(
     auto shader_group_name = layer_material->get_parameters().get("osl_surface");
     asr::ShaderGroup* mtl_group = assembly.shader_groups().get_by_name(shader_group_name);
 
-    // Don't copy last shader and last connection
+    // Don't copy last shader and last connection. Texture layers that the parent group
+    // already has are shared, along with the connections to their inputs.
+    std::set<std::string> shared_layers;
+    size_t copied_layer_count = 0;
     for (auto shader = mtl_group->shaders().begin(); shader != --(mtl_group->shaders().end()); shader++)
     {
-        shader_group.add_shader(shader->get_type(), shader->get_shader(), shader->get_layer(), shader->get_parameters());
+        if (has_layer(shader_group, shader->get_layer()))
+            shared_layers.insert(shader->get_layer());
+        else
+        {
+            shader_group.add_shader(shader->get_type(), shader->get_shader(), shader->get_layer(), shader->get_parameters());
+            ++copied_layer_count;
+        }
     }
 
     for (auto conn = mtl_group->shader_connections().begin(); conn != --(mtl_group->shader_connections().end()); conn++)
     {
-        shader_group.add_connection(conn->get_src_layer(), conn->get_src_param(), conn->get_dst_layer(), conn->get_dst_param());
+        if (shared_layers.find(conn->get_dst_layer()) == shared_layers.end())
+            shader_group.add_connection(conn->get_src_layer(), conn->get_src_param(), conn->get_dst_layer(), conn->get_dst_param());
     }
 
     auto last_conn = mtl_group->shader_connections().get_by_index(mtl_group->shader_connections().size() - 1);
     shader_group.add_connection(layer_name.c_str(), last_conn->get_src_param(), shader_name, shader_input);
+
+    if (registry != nullptr)
+    {
+        registry->insert(shader_group, mat, layer_name, last_conn->get_src_param(), copied_layer_count);
+        registry->copy_entries(*mtl_group, shader_group);
+    }
 }
 
 void create_osl_shader(
@@ -561,6 +631,7 @@ void create_osl_shader(
     const OSLShaderInfo*    shader_info)
 {
     asr::ParamArray params;
+    ExprFormatter formatter;
     const auto t = GetCOREInterface()->GetTime();
 
     for (const auto& param_info : shader_info->m_params)
@@ -634,7 +705,7 @@ void create_osl_shader(
               case MaxParam::Float:
                 {
                     const float param_value = param_block->GetFloat(max_param.m_max_param_id, t, FOREVER);
-                    params.insert(max_param.m_osl_param_name.c_str(), fmt_osl_expr(param_value));
+                    params.insert(max_param.m_osl_param_name.c_str(), formatter.osl(param_value));
                 }
                 break;
 
@@ -643,35 +714,35 @@ void create_osl_shader(
               case MaxParam::IntMapper:
                 {
                     const int param_value = param_block->GetInt(max_param.m_max_param_id, t, FOREVER);
-                    params.insert(max_param.m_osl_param_name.c_str(), fmt_osl_expr(param_value));
+                    params.insert(max_param.m_osl_param_name.c_str(), formatter.osl(param_value));
                 }
                 break;
 
               case MaxParam::Color:
                 {
                     const auto param_value = param_block->GetColor(max_param.m_max_param_id, t);
-                    params.insert(max_param.m_osl_param_name.c_str(), fmt_osl_expr(to_color3f(param_value)));
+                    params.insert(max_param.m_osl_param_name.c_str(), formatter.osl(to_color3f(param_value)));
                 }
                 break;
 
               case MaxParam::VectorParam:
                 {
                     const Point3 param_value = param_block->GetPoint3(max_param.m_max_param_id, t);
-                    params.insert(max_param.m_osl_param_name.c_str(), fmt_osl_expr(to_vector3f(param_value)));
+                    params.insert(max_param.m_osl_param_name.c_str(), formatter.osl(to_vector3f(param_value)));
                 }
                 break;
 
               case MaxParam::NormalParam:
                 {
                     const Point3 param_value = param_block->GetPoint3(max_param.m_max_param_id, t);
-                    params.insert(max_param.m_osl_param_name.c_str(), fmt_osl_normal_expr(to_vector3f(param_value)));
+                    params.insert(max_param.m_osl_param_name.c_str(), formatter.osl_normal(to_vector3f(param_value)));
                 }
                 break;
 
               case MaxParam::PointParam:
                 {
                     const Point3 param_value = param_block->GetPoint3(max_param.m_max_param_id, t);
-                    params.insert(max_param.m_osl_param_name.c_str(), fmt_osl_point_expr(to_vector3f(param_value)));
+                    params.insert(max_param.m_osl_param_name.c_str(), formatter.osl_point(to_vector3f(param_value)));
                 }
                 break;
 
@@ -681,7 +752,7 @@ void create_osl_shader(
                     asf::tokenize(param_info.m_options, "|", fields);
 
                     const int param_value = param_block->GetInt(max_param.m_max_param_id, t, FOREVER);
-                    params.insert(max_param.m_osl_param_name.c_str(), fmt_osl_expr(fields[param_value]));
+                    params.insert(max_param.m_osl_param_name.c_str(), formatter.osl(fields[param_value]));
                 }
                 break;
 
@@ -690,7 +761,7 @@ void create_osl_shader(
                     const wchar_t* str_value;
                     param_block->GetValue(max_param.m_max_param_id, t, str_value, FOREVER);
                     if (str_value != nullptr)
-                        params.insert(max_param.m_osl_param_name.c_str(), fmt_osl_expr(wide_to_utf8(str_value)));
+                        params.insert(max_param.m_osl_param_name.c_str(), formatter.osl(wide_to_utf8(str_value)));
                 }
                 break;
             }
@@ -699,3 +770,84 @@ void create_osl_shader(
 
     shader_group.add_shader("shader", shader_info->m_shader_name.c_str(), layer_name, params);
 }
+
+
+//
+// SubMaterialLayerRegistry class implementation.
+//
+
+namespace
+{
+    SubMaterialLayerRegistry* g_current_sub_material_layer_registry = nullptr;
+}
+
+SubMaterialLayerRegistry::SubMaterialLayerRegistry()
+  : m_previous(g_current_sub_material_layer_registry)
+  , m_copied_layer_count(0)
+  , m_reused_layer_count(0)
+{
+    g_current_sub_material_layer_registry = this;
+}
+
+SubMaterialLayerRegistry::~SubMaterialLayerRegistry()
+{
+    g_current_sub_material_layer_registry = m_previous;
+}
+
+SubMaterialLayerRegistry* SubMaterialLayerRegistry::current()
+{
+    return g_current_sub_material_layer_registry;
+}
+
+bool SubMaterialLayerRegistry::find(
+    const asr::ShaderGroup&         shader_group,
+    Mtl*                            mtl,
+    std::string&                    layer,
+    std::string&                    output)
+{
+    const auto it = m_layers.find(Key(&shader_group, mtl));
+    if (it == m_layers.end())
+        return false;
+
+    layer = it->second.m_layer;
+    output = it->second.m_output;
+    m_reused_layer_count += it->second.m_layer_count;
+
+    return true;
+}
+
+void SubMaterialLayerRegistry::insert(
+    const asr::ShaderGroup&         shader_group,
+    Mtl*                            mtl,
+    const std::string&              layer,
+    const std::string&              output,
+    const size_t                    layer_count)
+{
+    SubMaterialLayer& sub_material_layer = m_layers[Key(&shader_group, mtl)];
+    sub_material_layer.m_layer = layer;
+    sub_material_layer.m_output = output;
+    sub_material_layer.m_layer_count = layer_count;
+
+    m_copied_layer_count += layer_count;
+}
+
+void SubMaterialLayerRegistry::copy_entries(
+    const asr::ShaderGroup&         source,
+    const asr::ShaderGroup&         dest)
+{
+    // Entries are ordered by shader group first.
+    for (auto it = m_layers.lower_bound(Key(&source, nullptr));
+         it != m_layers.end() && it->first.first == &source;
+         ++it)
+        m_layers.insert(std::make_pair(Key(&dest, it->first.second), it->second));
+}
+
+size_t SubMaterialLayerRegistry::get_copied_layer_count() const
+{
+    return m_copied_layer_count;
+}
+
+size_t SubMaterialLayerRegistry::get_reused_layer_count() const
+{
+    return m_reused_layer_count;
+}
@@ -30,6 +30,7 @@
 
 // appleseed.foundation headers.
 #include "foundation/platform/windows.h"    // include before 3ds Max headers
+#include "foundation/core/concepts/noncopyable.h"
 #include "foundation/image/color.h"
 #include "foundation/math/vector.h"
 
@@ -37,7 +38,10 @@
 #include <maxtypes.h>
 
 // Standard headers.
+#include <cstddef>
+#include <map>
 #include <string>
+#include <utility>
 
 // Forward declarations.
 namespace renderer { class Assembly; }
@@ -53,6 +57,7 @@ renderer::ParamArray get_uv_params(Texmap* texmap);
 
 renderer::ParamArray get_output_params(Texmap* texmap);
 
+// Format a single OSL expression. Use an ExprFormatter to format several expressions in a row.
 std::string fmt_osl_expr(const std::string& s);
 
 std::string fmt_osl_expr(const int value);
@@ -100,6 +105,64 @@ void connect_normal_map(
     const int               up_vector,
     const float             amount);
 
+// While a registry is alive, connect_sub_mtl() builds the layers of each sub-material once per
+// parent shader group and connects further references to the same sub-material to these layers.
+// Registries are meant to live on the stack for the duration of an export and can be nested;
+// the innermost one is used.
+class SubMaterialLayerRegistry
+  : public foundation::NonCopyable
+{
+  public:
+    SubMaterialLayerRegistry();
+    ~SubMaterialLayerRegistry();
+
+    // Return the innermost live registry, or nullptr if there is none.
+    static SubMaterialLayerRegistry* current();
+
+    // Return true if the layers of a given sub-material were built into a given shader group.
+    // If so, set `layer` and `output` to the layer and parameter providing its closure.
+    bool find(
+        const renderer::ShaderGroup&    shader_group,
+        Mtl*                            mtl,
+        std::string&                    layer,
+        std::string&                    output);
+
+    // Record that the layers of a sub-material were built into a given shader group.
+    void insert(
+        const renderer::ShaderGroup&    shader_group,
+        Mtl*                            mtl,
+        const std::string&              layer,
+        const std::string&              output,
+        const size_t                    layer_count);
+
+    // Record that the layers of a shader group were copied into another shader group, along
+    // with the layers of the sub-materials built into it.
+    void copy_entries(
+        const renderer::ShaderGroup&    source,
+        const renderer::ShaderGroup&    dest);
+
+    // Number of sub-material layers copied into parent shader groups.
+    size_t get_copied_layer_count() const;
+
+    // Number of sub-material layers that did not need to be copied again.
+    size_t get_reused_layer_count() const;
+
+  private:
+    struct SubMaterialLayer
+    {
+        std::string m_layer;
+        std::string m_output;
+        size_t      m_layer_count;
+    };
+
+    typedef std::pair<const renderer::ShaderGroup*, Mtl*> Key;
+
+    SubMaterialLayerRegistry*           m_previous;
+    std::map<Key, SubMaterialLayer>     m_layers;
+    size_t                              m_copied_layer_count;
+    size_t                              m_reused_layer_count;
+};
+
 void connect_sub_mtl(
     renderer::Assembly&     assembly,
     renderer::ShaderGroup&  shader_group,
@@ -30,11 +30,9 @@
 #include "seexprutils.h"
 
 // appleseed-max headers.
+#include "exprformatter.h"
 #include "utilities.h"
 
-// appleseed.foundation headers.
-#include "foundation/utility/string.h"
-
 // 3ds Max Headers.
 #include <assert1.h>
 #include <bitmap.h>
@@ -45,7 +43,8 @@ namespace asr = renderer;
 
 std::string fmt_se_expr(const asf::Color3f& srgb)
 {
-    return asf::format("[{0}, {1}, {2}]", srgb.r, srgb.g, srgb.b);
+    ExprFormatter formatter;
+    return formatter.se(srgb);
 }
 
 std::string fmt_se_expr(BitmapTex* bitmap_tex)
@@ -59,15 +58,16 @@ std::string fmt_se_expr(BitmapTex* bitmap_tex)
     const int width = bitmap->Width();
     const int height = bitmap->Height();
 
-    return asf::format("texture(\"{0}\", $u % {1}, $v % {2})", filepath, width, height);
+    ExprFormatter formatter;
+    return formatter.se_texture(filepath, width, height);
 }
 
 std::string fmt_se_expr(const float scalar, Texmap* map)
 {
-    auto value = asf::to_string(scalar);
+    ExprFormatter formatter;
 
     if (is_bitmap_texture(map))
-        value += asf::format(" * {0}", fmt_se_expr(static_cast<BitmapTex*>(map)));
+        return formatter.se_product(scalar, fmt_se_expr(static_cast<BitmapTex*>(map)).c_str());
 
-    return value;
+    return formatter.se_product(scalar, nullptr);
 }
@@ -0,0 +1,119 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/utility/string.h"
+
+// Standard headers.
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+//
+// The code in this file does not depend on the 3ds Max SDK.
+//
+
+// While a registry is alive, make_unique_name() (see utilities.h) remembers, per entity
+// container, the names it returned and the last numeric suffix appended to each name
+// instead of scanning the container. Registries are meant to live on the stack for the
+// duration of an export and can be nested; the innermost one is used.
+class UniqueNameRegistry
+  : public foundation::NonCopyable
+{
+  public:
+    UniqueNameRegistry();
+    ~UniqueNameRegistry();
+
+    // Return the innermost live registry, or nullptr if there is none.
+    static UniqueNameRegistry* current();
+
+    template <typename EntityContainer>
+    std::string make_unique_name(
+        const EntityContainer&  entities,
+        const std::string&      name);
+
+  private:
+    struct ContainerNames
+    {
+        std::unordered_set<std::string>         m_names;        // names returned so far
+        std::unordered_map<std::string, size_t> m_suffixes;     // last suffix appended to each name
+    };
+
+    UniqueNameRegistry*                                 m_previous;
+    std::unordered_map<const void*, ContainerNames>     m_containers;
+
+    template <typename EntityContainer>
+    static bool is_taken(
+        const EntityContainer&  entities,
+        const ContainerNames&   names,
+        const std::string&      name);
+};
+
+
+//
+// UniqueNameRegistry class implementation.
+//
+
+template <typename EntityContainer>
+std::string UniqueNameRegistry::make_unique_name(
+    const EntityContainer&  entities,
+    const std::string&      name)
+{
+    ContainerNames& names = m_containers[&entities];
+
+    std::string unique_name = name;
+
+    if (is_taken(entities, names, unique_name))
+    {
+        size_t& suffix = names.m_suffixes[name];
+        do
+        {
+            unique_name = name + "_" + foundation::to_string(++suffix);
+        } while (is_taken(entities, names, unique_name));
+    }
+
+    names.m_names.insert(unique_name);
+
+    return unique_name;
+}
+
+template <typename EntityContainer>
+bool UniqueNameRegistry::is_taken(
+    const EntityContainer&  entities,
+    const ContainerNames&   names,
+    const std::string&      name)
+{
+    // Entities may also be inserted without a name from the registry.
+    return
+        names.m_names.find(name) != names.m_names.end() ||
+        entities.get_by_name(name.c_str()) != nullptr;
+}
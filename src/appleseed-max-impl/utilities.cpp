@@ -57,6 +57,7 @@
 #include <stdmat.h>
 
 // Windows headers.
+#include <Psapi.h>
 #include <Shlwapi.h>
 
 namespace asf = foundation;
@@ -110,6 +111,24 @@ std::wstring utf8_to_wide(const char* str)
     return result;
 }
 
+size_t get_working_set_size()
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+
+    return counters.WorkingSetSize;
+}
+
+size_t get_peak_working_set_size()
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+
+    return counters.PeakWorkingSetSize;
+}
+
 std::string get_root_path()
 {
     wchar_t path[MAX_PATH];
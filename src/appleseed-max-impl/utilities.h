@@ -28,6 +28,9 @@
 
 #pragma once
 
+// appleseed-max headers.
+#include "uniquenameregistry.h"
+
 // appleseed.renderer headers.
 #include "renderer/api/scene.h"
 #include "renderer/api/utility.h"
@@ -37,8 +40,10 @@
 #include "foundation/image/image.h"
 #include "foundation/math/matrix.h"
 #include "foundation/math/vector.h"
+#include "foundation/core/concepts/noncopyable.h"
 #include "foundation/platform/windows.h"    // include before 3ds Max headers
 #include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/string.h"
 
 // 3ds Max headers.
 #include <assert1.h>
@@ -103,6 +108,15 @@ std::wstring utf8_to_wide(const std::string& str);
 std::wstring utf8_to_wide(const char* str);
 
 
+//
+// Process functions.
+//
+
+// Return the current and the peak working set sizes of the 3ds Max process, in bytes.
+size_t get_working_set_size();
+size_t get_peak_working_set_size();
+
+
 //
 // I/O and paths functions.
 //
@@ -158,6 +172,7 @@ foundation::auto_release_ptr<foundation::Image> render_bitmap_to_image(
 // Project construction functions.
 //
 
+// Return `name` if it isn't used in `entities`, otherwise `name` followed by a numeric suffix.
 template <typename EntityContainer>
 std::string make_unique_name(
     const EntityContainer&  entities,
@@ -323,6 +338,10 @@ std::string make_unique_name(
     const EntityContainer&  entities,
     const std::string&      name)
 {
+    UniqueNameRegistry* registry = UniqueNameRegistry::current();
+    if (registry != nullptr)
+        return registry->make_unique_name(entities, name);
+
     return
         entities.get_by_name(name.c_str()) == nullptr
             ? name